@@ -0,0 +1,332 @@
+/* buffer-cache.c: Cache of file system disk sectors.
+ *
+ * Every sector the inode layer reads or writes goes through one of
+ * BC_SECTORS slots, replaced with a second-chance clock.  Writes only
+ * dirty the slot.  The flusher writes dirty slots back every
+ * BC_FLUSH_INTERVAL, and buffer_cache_flush() does so on demand, as
+ * filesys_done() does at shutdown.  buffer_cache_flush_range() writes
+ * back just a run of sectors, such as the FAT's.  A dirty slot that
+ * the clock picks is written back before it is reused.
+ *
+ * Sequential readers ask for the next sector ahead of time.  Those
+ * requests queue up for the read-ahead thread, which loads them into
+ * the cache while the reader goes on.
+ *
+ * One lock covers the whole cache, but it is never held across a disk
+ * transfer or a copy to or from the caller's buffer, which may be a
+ * user page whose fault needs the cache itself.  A slot with a
+ * transfer or copy in progress is pinned, so the clock leaves it
+ * alone.  A slot that is still being read, or filled by a write, is
+ * not valid, and anyone who wants its data waits for io_done. */
+
+#include "filesys/buffer-cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Sectors the cache holds. */
+#define BC_SECTORS 64
+
+/* Ticks between two passes of the flusher, which bounds how long a
+ * write can stay in memory only. */
+#define BC_FLUSH_INTERVAL (30 * TIMER_FREQ)
+
+/* Read-ahead requests waiting at most; later ones are dropped. */
+#define BC_RA_QUEUE 16
+
+struct bc_slot {
+	disk_sector_t sector;       /* Sector held, if in_use. */
+	bool in_use;                /* Holds a sector. */
+	bool valid;                 /* DATA has been read. */
+	bool dirty;                 /* DATA is newer than the disk. */
+	bool accessed;              /* Used since the clock last passed. */
+	int pin_cnt;                /* Transfers and copies in progress. */
+	uint8_t *data;              /* DISK_SECTOR_SIZE bytes. */
+};
+
+static struct bc_slot slots[BC_SECTORS];
+static size_t clock_hand;
+static struct lock bc_lock;
+static struct condition io_done;    /* Some transfer finished. */
+
+/* Sectors waiting for the read-ahead thread, as a ring. */
+static disk_sector_t ra_queue[BC_RA_QUEUE];
+static size_t ra_head, ra_cnt;
+static struct condition ra_ready;   /* RA_QUEUE is not empty. */
+
+/* Statistics. */
+static long long hit_cnt;           /* Accesses served from the cache. */
+static long long miss_cnt;          /* Accesses that read the disk. */
+static long long ra_load_cnt;       /* Sectors read ahead. */
+static long long writeback_cnt;     /* Dirty sectors written back. */
+
+static void flusher (void *aux);
+static void read_ahead (void *aux);
+
+/* Initializes the buffer cache and starts its threads. */
+void
+buffer_cache_init (void) {
+	size_t page_cnt = BC_SECTORS * DISK_SECTOR_SIZE / PGSIZE;
+	uint8_t *data = palloc_get_multiple (PAL_ASSERT, page_cnt);
+	size_t i;
+
+	for (i = 0; i < BC_SECTORS; i++) {
+		slots[i].in_use = false;
+		slots[i].pin_cnt = 0;
+		slots[i].data = data + i * DISK_SECTOR_SIZE;
+	}
+	lock_init (&bc_lock);
+	cond_init (&io_done);
+	cond_init (&ra_ready);
+	thread_create ("bc_flusher", PRI_DEFAULT, flusher, NULL);
+	thread_create ("bc_readahead", PRI_DEFAULT, read_ahead, NULL);
+}
+
+/* Returns the slot holding SECTOR, or a null pointer. */
+static struct bc_slot *
+lookup (disk_sector_t sector) {
+	size_t i;
+
+	for (i = 0; i < BC_SECTORS; i++)
+		if (slots[i].in_use && slots[i].sector == sector)
+			return &slots[i];
+	return NULL;
+}
+
+/* Writes the dirty SLOT back to disk.  Drops the cache lock while
+ * the disk is busy; a write that lands on SLOT meanwhile leaves it
+ * dirty again. */
+static void
+write_back (struct bc_slot *slot) {
+	slot->dirty = false;
+	slot->pin_cnt++;
+	lock_release (&bc_lock);
+	disk_write (filesys_disk, slot->sector, slot->data);
+	lock_acquire (&bc_lock);
+	slot->pin_cnt--;
+	writeback_cnt++;
+	cond_broadcast (&io_done, &bc_lock);
+}
+
+/* Frees a slot with the clock and returns it, or returns a null
+ * pointer if every slot is busy with a transfer.  A dirty victim is
+ * written back first and taken on a later turn of the hand, unless
+ * it was used again meanwhile. */
+static struct bc_slot *
+evict (void) {
+	size_t i;
+
+	for (i = 0; i < 3 * BC_SECTORS; i++) {
+		struct bc_slot *slot = &slots[clock_hand];
+		clock_hand = (clock_hand + 1) % BC_SECTORS;
+
+		if (!slot->in_use)
+			return slot;
+		if (slot->pin_cnt > 0)
+			continue;
+		if (slot->accessed)
+			slot->accessed = false;
+		else if (slot->dirty)
+			write_back (slot);
+		else {
+			slot->in_use = false;
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+/* Returns the slot holding SECTOR, loading the sector into a free
+ * slot on a miss.  If READ is false the caller is about to overwrite
+ * the whole sector, so a miss skips the disk read and returns a slot
+ * that stays invalid until the caller filled it; otherwise the slot
+ * is valid.  Must hold the cache lock, which this function may drop
+ * and take again. */
+static struct bc_slot *
+get_slot (disk_sector_t sector, bool read) {
+	for (;;) {
+		struct bc_slot *slot = lookup (sector);
+
+		if (slot != NULL) {
+			if (slot->valid) {
+				slot->accessed = true;
+				hit_cnt++;
+				return slot;
+			}
+			/* Somebody else is reading it in. */
+			cond_wait (&io_done, &bc_lock);
+			continue;
+		}
+
+		slot = evict ();
+		if (slot == NULL) {
+			cond_wait (&io_done, &bc_lock);
+			continue;
+		}
+		/* Evicting may have dropped the lock, and SECTOR may have
+		 * been loaded meanwhile. */
+		if (lookup (sector) != NULL)
+			continue;
+		slot->sector = sector;
+		slot->in_use = true;
+		slot->dirty = false;
+		slot->accessed = true;
+		miss_cnt++;
+		if (!read) {
+			slot->valid = false;
+			return slot;
+		}
+
+		slot->valid = false;
+		slot->pin_cnt++;
+		lock_release (&bc_lock);
+		disk_read (filesys_disk, sector, slot->data);
+		lock_acquire (&bc_lock);
+		slot->pin_cnt--;
+		slot->valid = true;
+		cond_broadcast (&io_done, &bc_lock);
+		return slot;
+	}
+}
+
+/* Pins SLOT and drops the cache lock, for a copy to or from the
+ * caller's buffer. */
+static void
+copy_begin (struct bc_slot *slot) {
+	slot->pin_cnt++;
+	lock_release (&bc_lock);
+}
+
+/* Takes the cache lock back after a copy and unpins SLOT. */
+static void
+copy_end (struct bc_slot *slot) {
+	lock_acquire (&bc_lock);
+	slot->pin_cnt--;
+	cond_broadcast (&io_done, &bc_lock);
+}
+
+/* Reads SIZE bytes at offset OFS of SECTOR into BUFFER. */
+void
+buffer_cache_read (disk_sector_t sector, void *buffer, int ofs, int size) {
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&bc_lock);
+	struct bc_slot *slot = get_slot (sector, true);
+	copy_begin (slot);
+	memcpy (buffer, slot->data + ofs, size);
+	copy_end (slot);
+	lock_release (&bc_lock);
+}
+
+/* Writes SIZE bytes from BUFFER at offset OFS of SECTOR.  The disk
+ * is written later. */
+void
+buffer_cache_write (disk_sector_t sector, const void *buffer, int ofs,
+		int size) {
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&bc_lock);
+	struct bc_slot *slot = get_slot (sector, size < DISK_SECTOR_SIZE);
+	copy_begin (slot);
+	memcpy (slot->data + ofs, buffer, size);
+	copy_end (slot);
+	/* Marked after the copy, so a write-back that raced with it
+	 * leaves the slot dirty. */
+	slot->valid = true;
+	slot->dirty = true;
+	lock_release (&bc_lock);
+}
+
+/* Asks for SECTOR to be loaded in the background, if it is not
+ * cached already. */
+void
+buffer_cache_read_ahead (disk_sector_t sector) {
+	lock_acquire (&bc_lock);
+	if (lookup (sector) == NULL && ra_cnt < BC_RA_QUEUE) {
+		ra_queue[(ra_head + ra_cnt++) % BC_RA_QUEUE] = sector;
+		cond_signal (&ra_ready, &bc_lock);
+	}
+	lock_release (&bc_lock);
+}
+
+/* Returns true if SECTOR is in the cache. */
+bool
+buffer_cache_holds (disk_sector_t sector) {
+	bool held;
+
+	lock_acquire (&bc_lock);
+	held = lookup (sector) != NULL;
+	lock_release (&bc_lock);
+	return held;
+}
+
+/* Writes every dirty sector back to disk. */
+void
+buffer_cache_flush (void) {
+	size_t i;
+
+	lock_acquire (&bc_lock);
+	for (i = 0; i < BC_SECTORS; i++)
+		if (slots[i].in_use && slots[i].valid && slots[i].dirty
+				&& slots[i].pin_cnt == 0)
+			write_back (&slots[i]);
+	lock_release (&bc_lock);
+}
+
+/* Writes the dirty sectors among the CNT sectors starting at START
+ * back to disk, in ascending order. */
+void
+buffer_cache_flush_range (disk_sector_t start, size_t cnt) {
+	size_t i;
+
+	lock_acquire (&bc_lock);
+	for (i = 0; i < cnt; i++) {
+		struct bc_slot *slot = lookup (start + i);
+		if (slot != NULL && slot->valid && slot->dirty && slot->pin_cnt == 0)
+			write_back (slot);
+	}
+	lock_release (&bc_lock);
+}
+
+/* Write-behind thread. */
+static void
+flusher (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (BC_FLUSH_INTERVAL);
+		buffer_cache_flush ();
+	}
+}
+
+/* Loads the sectors sequential readers will want next. */
+static void
+read_ahead (void *aux UNUSED) {
+	lock_acquire (&bc_lock);
+	for (;;) {
+		while (ra_cnt == 0)
+			cond_wait (&ra_ready, &bc_lock);
+		disk_sector_t sector = ra_queue[ra_head];
+		ra_head = (ra_head + 1) % BC_RA_QUEUE;
+		ra_cnt--;
+
+		if (lookup (sector) == NULL) {
+			get_slot (sector, true);
+			/* get_slot() took it for a miss; it is not one yet. */
+			miss_cnt--;
+			ra_load_cnt++;
+		}
+	}
+}
+
+/* Prints buffer cache statistics. */
+void
+buffer_cache_print_stats (void) {
+	printf ("Buffer cache: %lld hits, %lld misses, %lld read ahead, "
+			"%lld written back\n",
+			hit_cnt, miss_cnt, ra_load_cnt, writeback_cnt);
+}
@@ -1,15 +1,18 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include <round.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir {
 	struct inode *inode;                /* Backing store. */
-	off_t pos;                          /* Current position. */
+	off_t pos;                          /* Index of the next entry read. */
 };
 
 /* A single directory entry. */
@@ -19,11 +22,217 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
-/* Creates a directory with space for ENTRY_CNT entries in the
- * given SECTOR.  Returns true if successful, false on failure. */
+/* Hashed directories.
+ *
+ * dir_create() lays a directory out as a header sector followed by
+ * BUCKET_CNT bucket sectors.  A name goes into the bucket its hash
+ * selects or, if that one is full, into the first bucket after it
+ * with room.  Every bucket passed over on the way is marked as
+ * overflowed, so a search can stop at the first bucket that is not.
+ * Removing a name leaves the marks alone.
+ *
+ * When no bucket has room for a new name, dir_add() doubles the
+ * bucket count, appending the new buckets to the file, and moves
+ * every entry to where the new count hashes it.  The count lives
+ * only in the header, so every opener of the directory sees it.
+ *
+ * Directories written before this format have no header.  They are
+ * plain arrays of entries and are still searched linearly. */
+
+/* Identifies a hashed directory. */
+#define DIR_MAGIC 0x44495248
+
+/* Start of the header sector; the rest of it is unused. */
+struct dir_header {
+	uint32_t magic;                     /* DIR_MAGIC. */
+	uint32_t bucket_cnt;                /* Bucket sectors that follow. */
+};
+
+/* Entries in one bucket. */
+#define BUCKET_ENTRIES \
+	((DISK_SECTOR_SIZE - sizeof (uint32_t)) / sizeof (struct dir_entry))
+
+/* A bucket.  Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct dir_bucket {
+	uint32_t overflow;                  /* A name went past this bucket. */
+	struct dir_entry entries[BUCKET_ENTRIES];
+	uint8_t unused[DISK_SECTOR_SIZE - sizeof (uint32_t)
+		- BUCKET_ENTRIES * sizeof (struct dir_entry)];
+};
+
+/* Returns the byte offset of bucket B. */
+static inline off_t
+bucket_ofs (size_t b) {
+	return (off_t) (b + 1) * DISK_SECTOR_SIZE;
+}
+
+/* Returns the byte offset of entry I of bucket B. */
+static inline off_t
+bucket_entry_ofs (size_t b, size_t i) {
+	return bucket_ofs (b) + offsetof (struct dir_bucket, entries)
+		+ i * sizeof (struct dir_entry);
+}
+
+/* Returns the bucket NAME hashes to among BUCKET_CNT. */
+static size_t
+home_bucket (size_t bucket_cnt, const char *name) {
+	return hash_string (name) % bucket_cnt;
+}
+
+/* Names cached at most. */
+#define DCACHE_MAX 512
+
+/* A cached result of looking up NAME in the directory whose inode
+ * is in DIR_SECTOR.  A negative entry records that there is no
+ * such name. */
+struct dentry {
+	struct hash_elem elem;              /* Element in dentries. */
+	struct list_elem lru_elem;          /* Element in dentry_lru. */
+	disk_sector_t dir_sector;           /* Directory searched. */
+	char name[NAME_MAX + 1];            /* Name searched for. */
+	bool negative;                      /* NAME is not in the directory. */
+	disk_sector_t inode_sector;         /* If positive, the file found. */
+	off_t ofs;                          /* If positive, its entry's offset. */
+};
+
+static struct hash dentries;
+static struct list dentry_lru;          /* Least recently used first. */
+static struct lock dcache_lock;
+
+/* Statistics. */
+static long long dcache_hit_cnt;        /* Lookups served by the cache. */
+static long long dcache_neg_hit_cnt;    /* ...of which were negative. */
+static long long dcache_miss_cnt;       /* Lookups that scanned. */
+
+static uint64_t
+dentry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct dentry *d = hash_entry (e, struct dentry, elem);
+	return hash_string (d->name) ^ hash_int (d->dir_sector);
+}
+
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dentry *a = hash_entry (a_, struct dentry, elem);
+	const struct dentry *b = hash_entry (b_, struct dentry, elem);
+
+	if (a->dir_sector != b->dir_sector)
+		return a->dir_sector < b->dir_sector;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the directory module. */
+void
+dir_init (void) {
+	hash_init (&dentries, dentry_hash, dentry_less, NULL);
+	list_init (&dentry_lru);
+	lock_init (&dcache_lock);
+}
+
+/* Returns the cached entry for NAME in DIR_SECTOR, or a null
+ * pointer.  Must hold dcache_lock. */
+static struct dentry *
+dcache_find (disk_sector_t dir_sector, const char *name) {
+	struct dentry key;
+	struct hash_elem *e;
+
+	key.dir_sector = dir_sector;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&dentries, &key.elem);
+	return e != NULL ? hash_entry (e, struct dentry, elem) : NULL;
+}
+
+/* Removes D from the cache and frees it.  Must hold dcache_lock. */
+static void
+dcache_drop (struct dentry *d) {
+	hash_delete (&dentries, &d->elem);
+	list_remove (&d->lru_elem);
+	free (d);
+}
+
+/* Records that NAME in DIR_SECTOR is the file in INODE_SECTOR, with
+ * its entry at OFS, or that it does not exist if NEGATIVE.  NAME
+ * must not be longer than NAME_MAX.  Failing to allocate just
+ * leaves the name uncached. */
+static void
+dcache_enter (disk_sector_t dir_sector, const char *name, bool negative,
+		disk_sector_t inode_sector, off_t ofs) {
+	struct dentry *d;
+
+	lock_acquire (&dcache_lock);
+	d = dcache_find (dir_sector, name);
+	if (d == NULL) {
+		if (hash_size (&dentries) >= DCACHE_MAX)
+			dcache_drop (list_entry (list_front (&dentry_lru),
+						struct dentry, lru_elem));
+		d = malloc (sizeof *d);
+		if (d == NULL)
+			goto done;
+		d->dir_sector = dir_sector;
+		strlcpy (d->name, name, sizeof d->name);
+		hash_insert (&dentries, &d->elem);
+	} else
+		list_remove (&d->lru_elem);
+	list_push_back (&dentry_lru, &d->lru_elem);
+	d->negative = negative;
+	d->inode_sector = inode_sector;
+	d->ofs = ofs;
+done:
+	lock_release (&dcache_lock);
+}
+
+/* Forgets every name cached for the directory in DIR_SECTOR, whose
+ * sector is being reused. */
+static void
+dcache_purge (disk_sector_t dir_sector) {
+	struct list_elem *e;
+
+	lock_acquire (&dcache_lock);
+	for (e = list_begin (&dentry_lru); e != list_end (&dentry_lru);) {
+		struct dentry *d = list_entry (e, struct dentry, lru_elem);
+		e = list_next (e);
+		if (d->dir_sector == dir_sector)
+			dcache_drop (d);
+	}
+	lock_release (&dcache_lock);
+}
+
+/* Prints directory entry cache statistics. */
+void
+dir_print_stats (void) {
+	printf ("Dentry cache: %lld hits (%lld negative), %lld misses\n",
+			dcache_hit_cnt, dcache_neg_hit_cnt, dcache_miss_cnt);
+}
+
+/* Creates a hashed directory with space for ENTRY_CNT entries in
+ * the given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (disk_sector_t sector, size_t entry_cnt) {
-	return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+	size_t bucket_cnt = DIV_ROUND_UP (entry_cnt, BUCKET_ENTRIES);
+	struct dir_header h;
+	struct inode *inode;
+	bool success = false;
+
+	/* If this assertion fails, the bucket structure is not exactly
+	 * one sector in size, and you should fix that. */
+	ASSERT (sizeof (struct dir_bucket) == DISK_SECTOR_SIZE);
+
+	if (bucket_cnt == 0)
+		bucket_cnt = 1;
+	dcache_purge (sector);
+	if (!inode_create (sector, bucket_ofs (bucket_cnt)))
+		return false;
+
+	inode = inode_open (sector);
+	if (inode != NULL) {
+		h.magic = DIR_MAGIC;
+		h.bucket_cnt = bucket_cnt;
+		success = inode_write_at (inode, &h, sizeof h, 0) == sizeof h;
+		if (!success)
+			inode_remove (inode);
+		inode_close (inode);
+	}
+	return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -71,30 +280,292 @@ dir_get_inode (struct dir *dir) {
 	return dir->inode;
 }
 
+/* Returns the number of buckets of DIR, or 0 if DIR is flat. */
+static size_t
+bucket_count (const struct dir *dir) {
+	struct dir_header h;
+
+	if (inode_read_at (dir->inode, &h, sizeof h, 0) == sizeof h
+			&& h.magic == DIR_MAGIC)
+		return h.bucket_cnt;
+	return 0;
+}
+
+/* Returns the byte offset of entry IDX of DIR, which has BUCKET_CNT
+ * buckets, counting from 0 in disk order, or -1 if DIR has no such
+ * entry. */
+static off_t
+entry_ofs (size_t bucket_cnt, size_t idx) {
+	if (bucket_cnt == 0)
+		return idx * sizeof (struct dir_entry);
+	if (idx >= bucket_cnt * BUCKET_ENTRIES)
+		return -1;
+	return bucket_entry_ofs (idx / BUCKET_ENTRIES, idx % BUCKET_ENTRIES);
+}
+
+/* Outcome of searching a directory for a name. */
+enum lookup_result {
+	LOOKUP_FOUND,                       /* The name is there. */
+	LOOKUP_MISSING,                     /* The name is not there. */
+	LOOKUP_ERROR                        /* Out of memory or a bad read. */
+};
+
+/* Searches the BUCKET_CNT buckets of the hashed directory DIR for
+ * NAME.  If it is there, sets *EP to the entry and *OFSP to its
+ * offset. */
+static enum lookup_result
+hashed_scan (const struct dir *dir, size_t bucket_cnt, const char *name,
+		struct dir_entry *ep, off_t *ofsp) {
+	struct dir_bucket *bucket = malloc (sizeof *bucket);
+	size_t b = home_bucket (bucket_cnt, name);
+	enum lookup_result result = LOOKUP_MISSING;
+	size_t n, i;
+
+	if (bucket == NULL)
+		return LOOKUP_ERROR;
+	for (n = 0; n < bucket_cnt && result == LOOKUP_MISSING;
+			n++, b = (b + 1) % bucket_cnt) {
+		/* Every bucket lies inside the file, so a short read is
+		 * not the end of the search. */
+		if (inode_read_at (dir->inode, bucket, sizeof *bucket, bucket_ofs (b))
+				!= sizeof *bucket) {
+			result = LOOKUP_ERROR;
+			break;
+		}
+		for (i = 0; i < BUCKET_ENTRIES; i++) {
+			struct dir_entry *e = &bucket->entries[i];
+			if (e->in_use && !strcmp (name, e->name)) {
+				*ep = *e;
+				*ofsp = bucket_entry_ofs (b, i);
+				result = LOOKUP_FOUND;
+				break;
+			}
+		}
+		if (!bucket->overflow)
+			break;
+	}
+	free (bucket);
+	return result;
+}
+
+/* Searches the flat directory DIR for NAME, like hashed_scan().  A
+ * short read is the end of the file. */
+static enum lookup_result
+flat_scan (const struct dir *dir, const char *name,
+		struct dir_entry *ep, off_t *ofsp) {
+	struct dir_entry e;
+	size_t ofs;
+
+	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+			ofs += sizeof e)
+		if (e.in_use && !strcmp (name, e.name)) {
+			*ep = e;
+			*ofsp = ofs;
+			return LOOKUP_FOUND;
+		}
+	return LOOKUP_MISSING;
+}
+
 /* Searches DIR for a file with the given NAME.
- * If successful, returns true, sets *EP to the directory entry
- * if EP is non-null, and sets *OFSP to the byte offset of the
+ * If it is there, returns LOOKUP_FOUND, sets *EP to the directory
+ * entry if EP is non-null, and sets *OFSP to the byte offset of the
  * directory entry if OFSP is non-null.
- * otherwise, returns false and ignores EP and OFSP. */
-static bool
+ * otherwise, returns LOOKUP_MISSING, or LOOKUP_ERROR if the search
+ * could not finish, and ignores EP and OFSP.
+ * The answer comes from the dentry cache if it is there, and
+ * goes into it otherwise.  Only a search that finished is cached. */
+static enum lookup_result
 lookup (const struct dir *dir, const char *name,
 		struct dir_entry *ep, off_t *ofsp) {
+	disk_sector_t dir_sector;
 	struct dir_entry e;
-	size_t ofs;
+	struct dentry *d;
+	size_t bucket_cnt;
+	off_t ofs;
+	enum lookup_result result;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (e.in_use && !strcmp (name, e.name)) {
-			if (ep != NULL)
-				*ep = e;
+	dir_sector = inode_get_inumber (dir->inode);
+
+	/* No entry can hold a longer name. */
+	if (strlen (name) > NAME_MAX)
+		return LOOKUP_MISSING;
+
+	lock_acquire (&dcache_lock);
+	d = dcache_find (dir_sector, name);
+	if (d != NULL) {
+		bool found = !d->negative;
+
+		list_remove (&d->lru_elem);
+		list_push_back (&dentry_lru, &d->lru_elem);
+		dcache_hit_cnt++;
+		if (found) {
+			if (ep != NULL) {
+				ep->inode_sector = d->inode_sector;
+				strlcpy (ep->name, d->name, sizeof ep->name);
+				ep->in_use = true;
+			}
 			if (ofsp != NULL)
-				*ofsp = ofs;
-			return true;
-		}
-	return false;
+				*ofsp = d->ofs;
+		} else
+			dcache_neg_hit_cnt++;
+		lock_release (&dcache_lock);
+		return found ? LOOKUP_FOUND : LOOKUP_MISSING;
+	}
+	dcache_miss_cnt++;
+	lock_release (&dcache_lock);
+
+	bucket_cnt = bucket_count (dir);
+	if (bucket_cnt > 0)
+		result = hashed_scan (dir, bucket_cnt, name, &e, &ofs);
+	else
+		result = flat_scan (dir, name, &e, &ofs);
+	if (result == LOOKUP_MISSING)
+		dcache_enter (dir_sector, name, true, 0, 0);
+	if (result != LOOKUP_FOUND)
+		return result;
+	dcache_enter (dir_sector, name, false, e.inode_sector, ofs);
+	if (ep != NULL)
+		*ep = e;
+	if (ofsp != NULL)
+		*ofsp = ofs;
+	return LOOKUP_FOUND;
+}
+
+/* Finds a free entry for NAME among the BUCKET_CNT buckets of the
+ * hashed directory DIR, reading them into BUCKET, and marks the full
+ * buckets it passes over as overflowed.  Sets *OFSP to the entry's
+ * offset, or to -1 if every bucket is full.  Returns false if a read
+ * or write fails. */
+static bool
+find_free (struct dir *dir, size_t bucket_cnt, const char *name,
+		struct dir_bucket *bucket, off_t *ofsp) {
+	static const uint32_t overflow = 1;
+	size_t b = home_bucket (bucket_cnt, name);
+	size_t n, i;
+
+	for (n = 0; n < bucket_cnt; n++, b = (b + 1) % bucket_cnt) {
+		if (inode_read_at (dir->inode, bucket, sizeof *bucket, bucket_ofs (b))
+				!= sizeof *bucket)
+			return false;
+		for (i = 0; i < BUCKET_ENTRIES; i++)
+			if (!bucket->entries[i].in_use) {
+				*ofsp = bucket_entry_ofs (b, i);
+				return true;
+			}
+		if (!bucket->overflow
+				&& inode_write_at (dir->inode, &overflow, sizeof overflow,
+					bucket_ofs (b)) != sizeof overflow)
+			return false;
+	}
+	*ofsp = -1;
+	return true;
+}
+
+/* Puts entry E into the BUCKET_CNT buckets at BUCKETS the way
+ * find_free() would on disk.  There must be room for it. */
+static void
+place_entry (struct dir_bucket *buckets, size_t bucket_cnt,
+		const struct dir_entry *e) {
+	size_t b = home_bucket (bucket_cnt, e->name);
+	size_t i;
+
+	for (;; b = (b + 1) % bucket_cnt) {
+		for (i = 0; i < BUCKET_ENTRIES; i++)
+			if (!buckets[b].entries[i].in_use) {
+				buckets[b].entries[i] = *e;
+				return;
+			}
+		buckets[b].overflow = 1;
+	}
+}
+
+/* Writes the CNT buckets at BUCKETS to DIR, starting with bucket
+ * FIRST.  Returns the number written before any failure. */
+static size_t
+write_buckets (struct dir *dir, const struct dir_bucket *buckets,
+		size_t first, size_t cnt) {
+	size_t b;
+
+	for (b = 0; b < cnt; b++)
+		if (inode_write_at (dir->inode, &buckets[b], sizeof buckets[b],
+					bucket_ofs (first + b)) != sizeof buckets[b])
+			break;
+	return b;
+}
+
+/* Doubles the BUCKET_CNT buckets of the hashed directory DIR and
+ * moves every entry to where the new count hashes it.  Returns the
+ * new count, or 0 if out of disk space or memory or a read or write
+ * fails, in which case DIR is left as it was.
+ *
+ * The new layout is built in memory first.  The buckets appended to
+ * the file are written next, which is the only step that allocates,
+ * and only then are the old buckets and the header overwritten.  If
+ * one of those writes fails, the old buckets are written back. */
+static size_t
+hashed_grow (struct dir *dir, size_t bucket_cnt) {
+	size_t new_cnt = bucket_cnt * 2;
+	struct dir_bucket *old = malloc (bucket_cnt * sizeof *old);
+	struct dir_bucket *new = calloc (new_cnt, sizeof *new);
+	struct dir_header h;
+	size_t b, i, written = 0;
+	bool success = false;
+
+	if (old == NULL || new == NULL)
+		goto done;
+	for (b = 0; b < bucket_cnt; b++)
+		if (inode_read_at (dir->inode, &old[b], sizeof old[b], bucket_ofs (b))
+				!= sizeof old[b])
+			goto done;
+	for (b = 0; b < bucket_cnt; b++)
+		for (i = 0; i < BUCKET_ENTRIES; i++)
+			if (old[b].entries[i].in_use)
+				place_entry (new, new_cnt, &old[b].entries[i]);
+
+	/* Past the old end of the file: nothing reads these yet. */
+	if (write_buckets (dir, new + bucket_cnt, bucket_cnt, bucket_cnt)
+			!= bucket_cnt)
+		goto done;
+
+	written = write_buckets (dir, new, 0, bucket_cnt);
+	h.magic = DIR_MAGIC;
+	h.bucket_cnt = new_cnt;
+	success = written == bucket_cnt
+		&& inode_write_at (dir->inode, &h, sizeof h, 0) == sizeof h;
+	if (!success)
+		write_buckets (dir, old, 0, written);
+
+done:
+	/* Entry offsets changed, or may have if undoing them failed. */
+	if (written > 0)
+		dcache_purge (inode_get_inumber (dir->inode));
+	free (new);
+	free (old);
+	return success ? new_cnt : 0;
+}
+
+/* Finds a free entry for NAME in the hashed directory DIR, which has
+ * BUCKET_CNT buckets, doubling them if all are full.  Returns true
+ * and sets *OFSP to the entry's offset if there is one. */
+static bool
+hashed_find_free (struct dir *dir, size_t bucket_cnt, const char *name,
+		off_t *ofsp) {
+	struct dir_bucket *bucket = malloc (sizeof *bucket);
+	bool found;
+
+	if (bucket == NULL)
+		return false;
+	found = find_free (dir, bucket_cnt, name, bucket, ofsp);
+	if (found && *ofsp < 0) {
+		bucket_cnt = hashed_grow (dir, bucket_cnt);
+		found = bucket_cnt > 0
+			&& find_free (dir, bucket_cnt, name, bucket, ofsp);
+	}
+	free (bucket);
+	return found && *ofsp >= 0;
 }
 
 /* Searches DIR for a file with the given NAME
@@ -109,7 +580,7 @@ dir_lookup (const struct dir *dir, const char *name,
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
+	if (lookup (dir, name, &e, NULL) == LOOKUP_FOUND)
 		*inode = inode_open (e.inode_sector);
 	else
 		*inode = NULL;
@@ -126,6 +597,7 @@ dir_lookup (const struct dir *dir, const char *name,
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	struct dir_entry e;
+	size_t bucket_cnt;
 	off_t ofs;
 	bool success = false;
 
@@ -136,27 +608,36 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
-	/* Check that NAME is not in use. */
-	if (lookup (dir, name, NULL, NULL))
+	/* Check that NAME is not in use, which takes a search that
+	 * finished. */
+	if (lookup (dir, name, NULL, NULL) != LOOKUP_MISSING)
 		goto done;
 
 	/* Set OFS to offset of free slot.
-	 * If there are no free slots, then it will be set to the
-	 * current end-of-file.
+	 * If there are no free slots in a flat directory, then it will
+	 * be set to the current end-of-file.
 
 	 * inode_read_at() will only return a short read at end of file.
 	 * Otherwise, we'd need to verify that we didn't get a short
 	 * read due to something intermittent such as low memory. */
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (!e.in_use)
-			break;
+	bucket_cnt = bucket_count (dir);
+	if (bucket_cnt > 0) {
+		if (!hashed_find_free (dir, bucket_cnt, name, &ofs))
+			goto done;
+	} else
+		for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+				ofs += sizeof e)
+			if (!e.in_use)
+				break;
 
 	/* Write slot. */
 	e.in_use = true;
 	strlcpy (e.name, name, sizeof e.name);
 	e.inode_sector = inode_sector;
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+	if (success)
+		dcache_enter (inode_get_inumber (dir->inode), name, false,
+				inode_sector, ofs);
 
 done:
 	return success;
@@ -176,7 +657,7 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (name != NULL);
 
 	/* Find directory entry. */
-	if (!lookup (dir, name, &e, &ofs))
+	if (lookup (dir, name, &e, &ofs) != LOOKUP_FOUND)
 		goto done;
 
 	/* Open inode. */
@@ -188,6 +669,7 @@ dir_remove (struct dir *dir, const char *name) {
 	e.in_use = false;
 	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
 		goto done;
+	dcache_enter (inode_get_inumber (dir->inode), name, true, 0, 0);
 
 	/* Remove inode. */
 	inode_remove (inode);
@@ -203,10 +685,13 @@ done:
  * contains no more entries. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
+	size_t bucket_cnt = bucket_count (dir);
 	struct dir_entry e;
+	off_t ofs;
 
-	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
-		dir->pos += sizeof e;
+	while ((ofs = entry_ofs (bucket_cnt, dir->pos)) >= 0
+			&& inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e) {
+		dir->pos++;
 		if (e.in_use) {
 			strlcpy (name, e.name, NAME_MAX + 1);
 			return true;
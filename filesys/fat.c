@@ -1,15 +1,20 @@
 #include "filesys/fat.h"
 #include "devices/disk.h"
+#include "devices/timer.h"
+#include "filesys/buffer-cache.h"
 #include "filesys/filesys.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include <bitmap.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 
 /* Should be less than DISK_SECTOR_SIZE */
 struct fat_boot {
 	unsigned int magic;
-	unsigned int sectors_per_cluster; /* Fixed to 1 */
+	unsigned int sectors_per_cluster; /* Chosen by fat_boot_create(). */
 	unsigned int total_sectors;
 	unsigned int fat_start;
 	unsigned int fat_sectors; /* Size of FAT in sectors. */
@@ -24,12 +29,32 @@ struct fat_fs {
 	disk_sector_t data_start;
 	cluster_t last_clst;
 	struct lock write_lock;
+	unsigned chain_gen;     /* Bumped whenever a chain is cut short. */
+
+	/* One bit per cluster, set if the cluster is in use, and one
+	 * summary bit per word of it, set if the word is all in use. */
+	uint64_t *used;
+	uint64_t *full;
+	size_t used_words;
+	size_t full_words;
+
+	struct bitmap *dirty;   /* FAT sectors changed since written. */
 };
 
+/* Ticks between two passes of the FAT flusher, which bounds how
+ * long a FAT change can stay in memory only. */
+#define FAT_FLUSH_INTERVAL (5 * TIMER_FREQ)
+
+/* FAT sectors that fat_flush() hands to the buffer cache at once. */
+#define FAT_FLUSH_BATCH 16
+
 static struct fat_fs *fat_fs;
 
 void fat_boot_create (void);
 void fat_fs_init (void);
+static void fat_bitmap_build (void);
+static void fat_flush (void);
+static void fat_flusher (void *aux);
 
 void
 fat_init (void) {
@@ -38,12 +63,7 @@ fat_init (void) {
 		PANIC ("FAT init failed");
 
 	// Read boot sector from the disk
-	unsigned int *bounce = malloc (DISK_SECTOR_SIZE);
-	if (bounce == NULL)
-		PANIC ("FAT init failed");
-	disk_read (filesys_disk, FAT_BOOT_SECTOR, bounce);
-	memcpy (&fat_fs->bs, bounce, sizeof (fat_fs->bs));
-	free (bounce);
+	buffer_cache_read (FAT_BOOT_SECTOR, &fat_fs->bs, 0, sizeof (fat_fs->bs));
 
 	// Extract FAT info
 	if (fat_fs->bs.magic != FAT_MAGIC)
@@ -51,66 +71,47 @@ fat_init (void) {
 	fat_fs_init ();
 }
 
+/* Allocates an empty in-memory FAT.  It is rounded up to whole
+ * sectors, so every FAT sector is read and written in place. */
+static void
+fat_table_alloc (void) {
+	free (fat_fs->fat);
+	if (fat_fs->dirty != NULL)
+		bitmap_destroy (fat_fs->dirty);
+	fat_fs->fat = calloc (fat_fs->bs.fat_sectors, DISK_SECTOR_SIZE);
+	fat_fs->dirty = bitmap_create (fat_fs->bs.fat_sectors);
+	if (fat_fs->fat == NULL || fat_fs->dirty == NULL)
+		PANIC ("FAT allocation failed");
+}
+
 void
 fat_open (void) {
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT load failed");
+	static bool flusher_started;
+
+	fat_table_alloc ();
 
-	// Load FAT directly from the disk
+	// Load FAT in order, through the buffer cache, which may still
+	// hold sectors that fat_create() or fat_flush() wrote
 	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_read = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_read;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i,
-			           buffer + bytes_read);
-			bytes_read += DISK_SECTOR_SIZE;
-		} else {
-			uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT load failed");
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			memcpy (buffer + bytes_read, bounce, bytes_left);
-			bytes_read += bytes_left;
-			free (bounce);
-		}
+	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++)
+		buffer_cache_read (fat_fs->bs.fat_start + i,
+		                   buffer + i * DISK_SECTOR_SIZE, 0, DISK_SECTOR_SIZE);
+	fat_bitmap_build ();
+
+	if (!flusher_started) {
+		thread_create ("fat_flusher", PRI_DEFAULT, fat_flusher, NULL);
+		flusher_started = true;
 	}
 }
 
 void
 fat_close (void) {
 	// Write FAT boot sector
-	uint8_t *bounce = calloc (1, DISK_SECTOR_SIZE);
-	if (bounce == NULL)
-		PANIC ("FAT close failed");
-	memcpy (bounce, &fat_fs->bs, sizeof (fat_fs->bs));
-	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
-	free (bounce);
-
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
-		}
-	}
+	buffer_cache_write (FAT_BOOT_SECTOR, &fat_fs->bs, 0, sizeof (fat_fs->bs));
+	buffer_cache_flush_range (FAT_BOOT_SECTOR, 1);
+
+	// Write the FAT sectors that changed
+	fat_flush ();
 }
 
 void
@@ -119,32 +120,36 @@ fat_create (void) {
 	fat_boot_create ();
 	fat_fs_init ();
 
-	// Create FAT table
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT creation failed");
+	// Create FAT table, all of which has to be written
+	fat_table_alloc ();
+	bitmap_set_all (fat_fs->dirty, true);
+	fat_bitmap_build ();
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
 
 	// Fill up ROOT_DIR_CLUSTER region with 0
-	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
-	if (buf == NULL)
-		PANIC ("FAT create failed due to OOM");
-	disk_write (filesys_disk, cluster_to_sector (ROOT_DIR_CLUSTER), buf);
-	free (buf);
+	static uint8_t zeros[DISK_SECTOR_SIZE];
+	for (unsigned i = 0; i < fat_fs->bs.sectors_per_cluster; i++)
+		buffer_cache_write (cluster_to_sector (ROOT_DIR_CLUSTER) + i, zeros, 0,
+		                    DISK_SECTOR_SIZE);
 }
 
 void
 fat_boot_create (void) {
+	// Large disks get 4 kB clusters, which keeps the FAT and its
+	// chains short.
+	unsigned int sectors_per_cluster =
+	    disk_size (filesys_disk) >= FAT_LARGE_DISK
+	    ? SECTORS_PER_CLUSTER_LARGE : SECTORS_PER_CLUSTER;
 	unsigned int fat_sectors =
 	    (disk_size (filesys_disk) - 1)
-	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * SECTORS_PER_CLUSTER + 1) + 1;
+	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * sectors_per_cluster + 1) + 1;
 	fat_fs->bs = (struct fat_boot){
 	    .magic = FAT_MAGIC,
-	    .sectors_per_cluster = SECTORS_PER_CLUSTER,
+	    .sectors_per_cluster = sectors_per_cluster,
 	    .total_sectors = disk_size (filesys_disk),
-	    .fat_start = 1,
+	    .fat_start = FAT_START_SECTOR,
 	    .fat_sectors = fat_sectors,
 	    .root_dir_cluster = ROOT_DIR_CLUSTER,
 	};
@@ -152,7 +157,152 @@ fat_boot_create (void) {
 
 void
 fat_fs_init (void) {
-	/* TODO: Your code goes here. */
+	const struct fat_boot *bs = &fat_fs->bs;
+	unsigned int max_length = bs->fat_sectors
+		* (DISK_SECTOR_SIZE / sizeof (cluster_t));
+
+	/* Cluster 0 means "no cluster", so data starts at cluster 1. */
+	fat_fs->data_start = bs->fat_start + bs->fat_sectors;
+	fat_fs->fat_length =
+		(bs->total_sectors - fat_fs->data_start) / bs->sectors_per_cluster + 1;
+	if (fat_fs->fat_length > max_length)
+		fat_fs->fat_length = max_length;
+	fat_fs->last_clst = ROOT_DIR_CLUSTER;
+	fat_fs->chain_gen = 0;
+	lock_init (&fat_fs->write_lock);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Writeback                                                                  */
+/*----------------------------------------------------------------------------*/
+
+/* Writes the dirty FAT sectors to disk in ascending order.  Each
+ * run of consecutive dirty sectors is copied into the buffer cache
+ * FAT_FLUSH_BATCH sectors at a time under the write lock, and each
+ * batch is written back after the lock is dropped. */
+static void
+fat_flush (void) {
+	uint8_t *buffer = (uint8_t *) fat_fs->fat;
+	disk_sector_t start = fat_fs->bs.fat_start;
+	size_t i = 0;
+
+	for (;;) {
+		size_t end;
+
+		lock_acquire (&fat_fs->write_lock);
+		i = bitmap_scan (fat_fs->dirty, i, 1, true);
+		if (i == BITMAP_ERROR) {
+			lock_release (&fat_fs->write_lock);
+			break;
+		}
+		end = bitmap_scan (fat_fs->dirty, i, 1, false);
+		if (end == BITMAP_ERROR)
+			end = fat_fs->bs.fat_sectors;
+		if (end - i > FAT_FLUSH_BATCH)
+			end = i + FAT_FLUSH_BATCH;
+		bitmap_set_multiple (fat_fs->dirty, i, end - i, false);
+		for (size_t k = i; k < end; k++)
+			buffer_cache_write (start + k, buffer + k * DISK_SECTOR_SIZE, 0,
+			                    DISK_SECTOR_SIZE);
+		lock_release (&fat_fs->write_lock);
+
+		buffer_cache_flush_range (start + i, end - i);
+		i = end;
+	}
+}
+
+/* Writes changed FAT sectors back every FAT_FLUSH_INTERVAL. */
+static void
+fat_flusher (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (FAT_FLUSH_INTERVAL);
+		fat_flush ();
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free clusters                                                              */
+/*----------------------------------------------------------------------------*/
+
+/* Marks cluster CLST in use or free in the cluster bitmap. */
+static void
+cluster_mark (cluster_t clst, bool used) {
+	size_t w = clst / 64;
+	uint64_t bit = (uint64_t) 1 << (clst % 64);
+
+	if (used) {
+		fat_fs->used[w] |= bit;
+		if (fat_fs->used[w] == UINT64_MAX)
+			fat_fs->full[w / 64] |= (uint64_t) 1 << (w % 64);
+	} else {
+		fat_fs->used[w] &= ~bit;
+		fat_fs->full[w / 64] &= ~((uint64_t) 1 << (w % 64));
+	}
+}
+
+/* Builds the cluster bitmap from the FAT.  Cluster 0 and the bits
+ * past the end of the FAT count as in use, so they are never
+ * handed out. */
+static void
+fat_bitmap_build (void) {
+	size_t used_words = DIV_ROUND_UP (fat_fs->fat_length, 64);
+	size_t full_words = DIV_ROUND_UP (used_words, 64);
+	cluster_t c;
+
+	free (fat_fs->used);
+	free (fat_fs->full);
+	fat_fs->used = calloc (used_words, sizeof (uint64_t));
+	fat_fs->full = calloc (full_words, sizeof (uint64_t));
+	if (fat_fs->used == NULL || fat_fs->full == NULL)
+		PANIC ("FAT bitmap creation failed");
+	fat_fs->used_words = used_words;
+	fat_fs->full_words = full_words;
+
+	for (c = used_words; c < full_words * 64; c++)
+		fat_fs->full[c / 64] |= (uint64_t) 1 << (c % 64);
+	for (c = fat_fs->fat_length; c < used_words * 64; c++)
+		cluster_mark (c, true);
+	cluster_mark (0, true);
+	for (c = 1; c < fat_fs->fat_length; c++)
+		if (fat_fs->fat[c] != 0)
+			cluster_mark (c, true);
+}
+
+/* Returns the first word of the cluster bitmap at or after word W
+ * that has a free cluster, or fat_fs->used_words if there is none. */
+static size_t
+next_free_word (size_t w) {
+	size_t s = w / 64;
+	uint64_t bits;
+
+	if (w >= fat_fs->used_words)
+		return fat_fs->used_words;
+	bits = ~fat_fs->full[s] & (UINT64_MAX << (w % 64));
+	while (bits == 0) {
+		if (++s >= fat_fs->full_words)
+			return fat_fs->used_words;
+		bits = ~fat_fs->full[s];
+	}
+	return s * 64 + __builtin_ctzll (bits);
+}
+
+/* Returns the first free cluster at or after FROM, or 0 if there is
+ * none. */
+static cluster_t
+find_free (cluster_t from) {
+	size_t w = from / 64;
+	uint64_t bits;
+
+	if (w >= fat_fs->used_words)
+		return 0;
+	bits = ~fat_fs->used[w] & (UINT64_MAX << (from % 64));
+	if (bits == 0) {
+		w = next_free_word (w + 1);
+		if (w >= fat_fs->used_words)
+			return 0;
+		bits = ~fat_fs->used[w];
+	}
+	return w * 64 + __builtin_ctzll (bits);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -161,33 +311,166 @@ fat_fs_init (void) {
 
 /* Add a cluster to the chain.
  * If CLST is 0, start a new chain.
- * Returns 0 if fails to allocate a new cluster. */
+ * Returns 0 if fails to allocate a new cluster.
+ * The cluster right after CLST is taken if it is free, so chains
+ * stay contiguous.  Otherwise the search goes on from where the
+ * previous one stopped, wrapping around at the end of the FAT. */
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	cluster_t new = 0;
+
+	lock_acquire (&fat_fs->write_lock);
+	if (clst != 0 && clst + 1 < fat_fs->fat_length && fat_get (clst + 1) == 0)
+		new = clst + 1;
+	if (new == 0)
+		new = find_free (fat_fs->last_clst);
+	if (new == 0)
+		new = find_free (ROOT_DIR_CLUSTER + 1);
+	if (new != 0) {
+		fat_fs->last_clst = new;
+		fat_put (new, EOChain);
+		if (clst != 0)
+			fat_put (clst, new);
+	}
+	lock_release (&fat_fs->write_lock);
+	return new;
 }
 
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
-	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
+	if (pclst != 0)
+		fat_put (pclst, EOChain);
+	while (clst != 0 && clst != EOChain) {
+		cluster_t next = fat_get (clst);
+		fat_put (clst, 0);
+		clst = next;
+	}
+	/* Cluster indexes of the cut chain are stale now. */
+	fat_fs->chain_gen++;
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
 void
 fat_put (cluster_t clst, cluster_t val) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst > 0 && clst < fat_fs->fat_length);
+	if ((fat_fs->fat[clst] == 0) != (val == 0))
+		cluster_mark (clst, val != 0);
+	fat_fs->fat[clst] = val;
+	bitmap_mark (fat_fs->dirty,
+			clst / (DISK_SECTOR_SIZE / sizeof (cluster_t)));
 }
 
 /* Fetch a value in the FAT table. */
 cluster_t
 fat_get (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst > 0 && clst < fat_fs->fat_length);
+	return fat_fs->fat[clst];
+}
+
+/* Returns the number of sectors in a cluster.  A cluster's sectors
+ * are consecutive, so they can be moved as one transfer. */
+unsigned int
+fat_sectors_per_cluster (void) {
+	return fat_fs->bs.sectors_per_cluster;
+}
+
+/* Converts SECTOR, the first sector of a cluster, to its
+ * cluster #. */
+cluster_t
+sector_to_cluster (disk_sector_t sector) {
+	ASSERT (sector >= fat_fs->data_start);
+	ASSERT ((sector - fat_fs->data_start) % fat_fs->bs.sectors_per_cluster == 0);
+	return (sector - fat_fs->data_start) / fat_fs->bs.sectors_per_cluster
+		+ ROOT_DIR_CLUSTER;
 }
 
 /* Covert a cluster # to a sector number. */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst > 0 && clst < fat_fs->fat_length);
+	return fat_fs->data_start
+		+ (clst - ROOT_DIR_CLUSTER) * fat_fs->bs.sectors_per_cluster;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Cluster indexes                                                            */
+/*----------------------------------------------------------------------------*/
+
+/* Following a chain to its Nth cluster costs N fat_get() calls.  An
+ * index remembers the clusters of one chain as an array, filled in
+ * lazily as far as it has been followed, so seeking within the part
+ * already seen is O(1) and going further only walks the rest.
+ *
+ * Growing a chain with fat_create_chain() leaves the clusters an
+ * index knows about alone, so the index stays valid.  Cutting a
+ * chain with fat_remove_chain() may drop clusters an index still
+ * holds, so every index is reset the next time it is used. */
+
+/* Starts an index for the chain that starts at START. */
+void
+fat_index_init (struct fat_index *idx, cluster_t start) {
+	idx->start = start;
+	idx->clusters = NULL;
+	idx->cnt = 0;
+	idx->cap = 0;
+	idx->gen = fat_fs->chain_gen;
+}
+
+/* Frees the memory held by IDX. */
+void
+fat_index_destroy (struct fat_index *idx) {
+	free (idx->clusters);
+	idx->clusters = NULL;
+	idx->cnt = idx->cap = 0;
+}
+
+/* Returns the cluster at position N, counting from 0, of IDX's
+ * chain, or 0 if the chain is shorter than that.  Falls back to
+ * walking the chain from its last known cluster if out of memory. */
+cluster_t
+fat_index_seek (struct fat_index *idx, size_t n) {
+	cluster_t clst;
+	size_t pos;
+
+	if (idx->gen != fat_fs->chain_gen) {
+		idx->cnt = 0;
+		idx->gen = fat_fs->chain_gen;
+	}
+	if (idx->start == 0)
+		return 0;
+	if (n < idx->cnt)
+		return idx->clusters[n];
+
+	if (idx->cnt == 0) {
+		clst = idx->start;
+		pos = 0;
+	} else {
+		clst = idx->clusters[idx->cnt - 1];
+		pos = idx->cnt - 1;
+	}
+	for (;;) {
+		if (pos == idx->cnt) {
+			if (idx->cnt == idx->cap) {
+				size_t cap = idx->cap == 0 ? 16 : idx->cap * 2;
+				cluster_t *clusters = realloc (idx->clusters,
+						cap * sizeof *clusters);
+				if (clusters != NULL) {
+					idx->clusters = clusters;
+					idx->cap = cap;
+				}
+			}
+			if (idx->cnt < idx->cap)
+				idx->clusters[idx->cnt++] = clst;
+		}
+		if (pos == n)
+			return clst;
+		clst = fat_get (clst);
+		if (clst == EOChain || clst == 0)
+			return 0;
+		pos++;
+	}
 }
@@ -1,12 +1,33 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "devices/timer.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Ticks between two writes of the changed parts of the free map
+ * into the buffer cache.  They reach the disk when the cache writes
+ * them back, so an allocation can stay in memory only for this long
+ * plus the cache's own interval. */
+#define FREE_MAP_FLUSH_INTERVAL TIMER_FREQ
+
+/* Bits of the free map held by one sector of the free map file. */
+#define BITS_PER_SECTOR (DISK_SECTOR_SIZE * 8)
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
+static struct bitmap *dirty;         /* Free map file sectors to write. */
+
+/* Guards the two bitmaps and the file, so the flusher never writes
+ * to a closed file.  Nothing called with it held may allocate: the
+ * free map file never grows. */
+static struct lock free_map_lock;
+
+static void flusher (void *aux);
 
 /* Initializes the free map. */
 void
@@ -14,8 +35,25 @@ free_map_init (void) {
 	free_map = bitmap_create (disk_size (filesys_disk));
 	if (free_map == NULL)
 		PANIC ("bitmap creation failed--disk is too large");
+	dirty = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+				DISK_SECTOR_SIZE));
+	if (dirty == NULL)
+		PANIC ("bitmap creation failed--disk is too large");
 	bitmap_mark (free_map, FREE_MAP_SECTOR);
 	bitmap_mark (free_map, ROOT_DIR_SECTOR);
+	lock_init (&free_map_lock);
+}
+
+/* Notes that the bits for the CNT sectors starting at SECTOR
+ * changed, so the parts of the free map file holding them are
+ * written by the next flush.  Must be called after changing them. */
+static void
+mark_dirty (disk_sector_t sector, size_t cnt) {
+	size_t first = sector / BITS_PER_SECTOR;
+	size_t last = (sector + cnt - 1) / BITS_PER_SECTOR;
+
+	if (cnt > 0)
+		bitmap_set_multiple (dirty, first, last - first + 1, true);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -24,24 +62,77 @@ free_map_init (void) {
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-	if (sector != BITMAP_ERROR
-			&& free_map_file != NULL
-			&& !bitmap_write (free_map, free_map_file)) {
-		bitmap_set_multiple (free_map, sector, cnt, false);
-		sector = BITMAP_ERROR;
-	}
-	if (sector != BITMAP_ERROR)
+	disk_sector_t sector;
+
+	lock_acquire (&free_map_lock);
+	sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+	if (sector != BITMAP_ERROR) {
+		mark_dirty (sector, cnt);
 		*sectorp = sector;
+	}
+	lock_release (&free_map_lock);
 	return sector != BITMAP_ERROR;
 }
 
+/* Allocates up to CNT consecutive sectors starting at SECTOR,
+ * stopping at the first one in use.  Returns how many were
+ * allocated, which may be 0. */
+size_t
+free_map_allocate_at (disk_sector_t sector, size_t cnt) {
+	size_t n = 0;
+
+	lock_acquire (&free_map_lock);
+	while (n < cnt && sector + n < bitmap_size (free_map)
+			&& !bitmap_test (free_map, sector + n))
+		n++;
+	if (n > 0) {
+		bitmap_set_multiple (free_map, sector, n, true);
+		mark_dirty (sector, n);
+	}
+	lock_release (&free_map_lock);
+	return n;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (disk_sector_t sector, size_t cnt) {
+	lock_acquire (&free_map_lock);
 	ASSERT (bitmap_all (free_map, sector, cnt));
 	bitmap_set_multiple (free_map, sector, cnt, false);
-	bitmap_write (free_map, free_map_file);
+	mark_dirty (sector, cnt);
+	lock_release (&free_map_lock);
+}
+
+/* Writes the sectors of the free map file whose bits changed into
+ * the buffer cache.  A sector stays dirty until its write succeeds.
+ * Returns true if every dirty sector was written.  Must hold
+ * free_map_lock. */
+static bool
+free_map_flush (void) {
+	size_t i = 0;
+
+	ASSERT (lock_held_by_current_thread (&free_map_lock));
+	if (free_map_file == NULL)
+		return true;
+	while ((i = bitmap_scan (dirty, i, 1, true)) != BITMAP_ERROR) {
+		if (!bitmap_write_part (free_map, free_map_file,
+					i * DISK_SECTOR_SIZE, DISK_SECTOR_SIZE))
+			return false;
+		bitmap_reset (dirty, i);
+	}
+	return true;
+}
+
+/* Writes the changed parts of the free map back periodically. */
+static void
+flusher (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (FREE_MAP_FLUSH_INTERVAL);
+		/* Whatever failed to write is retried next time. */
+		lock_acquire (&free_map_lock);
+		free_map_flush ();
+		lock_release (&free_map_lock);
+	}
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -52,12 +143,19 @@ free_map_open (void) {
 		PANIC ("can't open free map");
 	if (!bitmap_read (free_map, free_map_file))
 		PANIC ("can't read free map");
+	bitmap_set_all (dirty, false);
+	thread_create ("free_map_flush", PRI_DEFAULT, flusher, NULL);
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) {
+	lock_acquire (&free_map_lock);
+	if (!free_map_flush ())
+		PANIC ("can't write free map");
 	file_close (free_map_file);
+	free_map_file = NULL;
+	lock_release (&free_map_lock);
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -74,4 +172,5 @@ free_map_create (void) {
 		PANIC ("can't open free map");
 	if (!bitmap_write (free_map, free_map_file))
 		PANIC ("can't write free map");
+	bitmap_set_all (dirty, false);
 }
@@ -1,22 +1,49 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/buffer-cache.h"
+#include "filesys/fat.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
-/* Identifies an inode. */
+/* Identifies an inode in the original format, whose data is a
+ * single run of sectors starting at START. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Identifies an inode whose data is described by extents. */
+#define INODE_EXTENT_MAGIC 0x494e4f45
+
+/* Identifies an inode whose data is a FAT chain. */
+#define INODE_FAT_MAGIC 0x494e4f46
+
+/* COUNT consecutive sectors starting at START. */
+struct extent {
+	disk_sector_t start;                /* First sector. */
+	uint32_t count;                     /* Number of sectors. */
+};
+
+/* Extents kept in the inode itself.  Later ones go to a single
+ * indirect sector, which holds INDIRECT_EXTENTS of them. */
+#define DIRECT_EXTENTS 61
+#define INDIRECT_EXTENTS (DISK_SECTOR_SIZE / sizeof (struct extent))
+#define MAX_EXTENTS (DIRECT_EXTENTS + INDIRECT_EXTENTS)
+
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk {
-	disk_sector_t start;                /* First data sector. */
+	disk_sector_t start;                /* First data sector, old format;
+	                                       first cluster, or 0, under
+	                                       EFILESYS. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
-	uint32_t unused[125];               /* Not used. */
+	uint32_t extent_cnt;                /* Extents in use. */
+	disk_sector_t indirect;             /* Sector of more extents, or 0. */
+	struct extent extents[DIRECT_EXTENTS]; /* In file order. */
+	uint32_t unused[1];                 /* Not used. */
 };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -28,14 +55,66 @@ bytes_to_sectors (off_t size) {
 
 /* In-memory inode. */
 struct inode {
-	struct list_elem elem;              /* Element in inode list. */
+	struct hash_elem elem;              /* Element in open_inodes. */
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	unsigned write_gen;                 /* Bumped by every write. */
+	off_t read_next;                    /* Where a sequential read goes on. */
 	struct inode_disk data;             /* Inode content. */
+
+#ifndef EFILESYS
+	/* Every extent of the file, direct and indirect, in file
+	 * order, and the file sector each one starts at. */
+	size_t ext_cnt;                     /* Extents in use. */
+	size_t ext_cap;                     /* Room in EXT and EXT_FIRST. */
+	struct extent *ext;
+	uint32_t *ext_first;
+#else
+	struct fat_index chain;             /* Clusters of the data chain. */
+	size_t ra_end;                      /* End of the cluster last read
+	                                       ahead, in file sectors. */
+#endif
 };
 
+/* Open inodes by sector, so that opening a single inode twice
+ * returns the same `struct inode'.  OPEN_INODES_LOCK guards the
+ * table and every inode's open_cnt, so inodes may be opened and
+ * closed without holding the file system lock. */
+static struct hash open_inodes;
+static struct lock open_inodes_lock;
+
+static uint64_t
+inode_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct inode, elem)->sector
+		< hash_entry (b, struct inode, elem)->sector;
+}
+
+/* Initializes the inode module. */
+void
+inode_init (void) {
+	hash_init (&open_inodes, inode_hash, inode_less, NULL);
+	lock_init (&open_inodes_lock);
+}
+
+/* Fills CNT sectors starting at SECTOR with zeros. */
+static void
+zero_sectors (disk_sector_t sector, size_t cnt) {
+	static char zeros[DISK_SECTOR_SIZE];
+	size_t i;
+
+	for (i = 0; i < cnt; i++)
+		buffer_cache_write (sector + i, zeros, 0, DISK_SECTOR_SIZE);
+}
+
+#ifndef EFILESYS
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
@@ -43,20 +122,342 @@ struct inode {
 static disk_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
-	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
-	else
+	if (pos < inode->data.length) {
+		uint32_t idx = pos / DISK_SECTOR_SIZE;
+		size_t lo = 0, hi = inode->ext_cnt;
+
+		/* Find the last extent that starts at or before IDX. */
+		while (hi - lo > 1) {
+			size_t mid = (lo + hi) / 2;
+			if (inode->ext_first[mid] <= idx)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		return inode->ext[lo].start + (idx - inode->ext_first[lo]);
+	} else
 		return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Returns the number of data sectors INODE has. */
+static size_t
+inode_sectors (const struct inode *inode) {
+	size_t last;
 
-/* Initializes the inode module. */
+	if (inode->ext_cnt == 0)
+		return 0;
+	last = inode->ext_cnt - 1;
+	return inode->ext_first[last] + inode->ext[last].count;
+}
+
+/* Appends COUNT sectors starting at START to INODE's extents.
+ * Returns false if out of memory or if the extent that would need
+ * the indirect sector cannot get one. */
+static bool
+append_extent (struct inode *inode, disk_sector_t start, uint32_t count) {
+	size_t n = inode->ext_cnt;
+
+	ASSERT (n < MAX_EXTENTS);
+
+	if (n == inode->ext_cap) {
+		size_t cap = n == 0 ? 4 : n * 2;
+		struct extent *ext;
+		uint32_t *first;
+
+		ext = realloc (inode->ext, cap * sizeof *ext);
+		if (ext == NULL)
+			return false;
+		inode->ext = ext;
+		first = realloc (inode->ext_first, cap * sizeof *first);
+		if (first == NULL)
+			return false;
+		inode->ext_first = first;
+		inode->ext_cap = cap;
+	}
+	if (n == DIRECT_EXTENTS && inode->data.indirect == 0
+			&& !free_map_allocate (1, &inode->data.indirect))
+		return false;
+
+	inode->ext[n].start = start;
+	inode->ext[n].count = count;
+	inode->ext_first[n] = inode_sectors (inode);
+	inode->ext_cnt++;
+	return true;
+}
+
+/* Gives INODE at least SECTORS zeroed data sectors.  New sectors go
+ * right after the file's last sector, or after the inode for an
+ * empty file, as long as those are free, so that files stay
+ * contiguous.  Otherwise the largest free run found by halving the
+ * request starts a new extent.  Returns false if the disk or the
+ * extent table fills up; sectors added until then stay with INODE. */
+static bool
+inode_grow (struct inode *inode, size_t sectors) {
+	size_t have = inode_sectors (inode);
+
+	while (have < sectors) {
+		size_t want = sectors - have;
+		disk_sector_t next = inode->sector + 1;
+		disk_sector_t start;
+		size_t got;
+
+		if (inode->ext_cnt > 0) {
+			struct extent *last = &inode->ext[inode->ext_cnt - 1];
+			next = last->start + last->count;
+		}
+		got = free_map_allocate_at (next, want);
+		if (got > 0 && inode->ext_cnt > 0) {
+			zero_sectors (next, got);
+			inode->ext[inode->ext_cnt - 1].count += got;
+			have += got;
+			continue;
+		}
+
+		if (inode->ext_cnt == MAX_EXTENTS) {
+			if (got > 0)
+				free_map_release (next, got);
+			return false;
+		}
+		start = next;
+		if (got == 0) {
+			for (got = want; !free_map_allocate (got, &start); got /= 2)
+				if (got == 1)
+					return false;
+		}
+		if (!append_extent (inode, start, got)) {
+			free_map_release (start, got);
+			return false;
+		}
+		zero_sectors (start, got);
+		have += got;
+	}
+	return true;
+}
+
+/* Gives INODE's sectors back to the free map, except the inode's
+ * own. */
+static void
+release_data (struct inode *inode) {
+	size_t i;
+
+	for (i = 0; i < inode->ext_cnt; i++)
+		free_map_release (inode->ext[i].start, inode->ext[i].count);
+	if (inode->data.indirect != 0)
+		free_map_release (inode->data.indirect, 1);
+}
+
+/* Writes INODE's length and extents to disk. */
+static void
+inode_store (struct inode *inode) {
+	struct inode_disk *d = &inode->data;
+	size_t i;
+
+	d->extent_cnt = inode->ext_cnt;
+	for (i = 0; i < inode->ext_cnt && i < DIRECT_EXTENTS; i++)
+		d->extents[i] = inode->ext[i];
+	if (inode->ext_cnt > DIRECT_EXTENTS)
+		buffer_cache_write (d->indirect, inode->ext + DIRECT_EXTENTS, 0,
+				(inode->ext_cnt - DIRECT_EXTENTS) * sizeof (struct extent));
+	buffer_cache_write (inode->sector, d, 0, DISK_SECTOR_SIZE);
+}
+
+/* Builds INODE's extent table from its on-disk inode, which must
+ * have been read into INODE->data.  An inode in the old format
+ * becomes a single extent, and is written in the new format the
+ * next time it changes.  Returns false if out of memory. */
+static bool
+load_data (struct inode *inode) {
+	struct inode_disk *d = &inode->data;
+	struct extent *more = NULL;
+	size_t i;
+
+	if (d->magic != INODE_EXTENT_MAGIC) {
+		size_t cnt = bytes_to_sectors (d->length);
+
+		d->magic = INODE_EXTENT_MAGIC;
+		d->extent_cnt = 0;
+		d->indirect = 0;
+		return cnt == 0 || append_extent (inode, d->start, cnt);
+	}
+
+	if (d->extent_cnt > DIRECT_EXTENTS) {
+		more = malloc (DISK_SECTOR_SIZE);
+		if (more == NULL)
+			return false;
+		buffer_cache_read (d->indirect, more, 0, DISK_SECTOR_SIZE);
+	}
+	for (i = 0; i < d->extent_cnt; i++) {
+		struct extent *e = i < DIRECT_EXTENTS
+			? &d->extents[i] : &more[i - DIRECT_EXTENTS];
+		if (!append_extent (inode, e->start, e->count))
+			break;
+	}
+	free (more);
+	return inode->ext_cnt == d->extent_cnt;
+}
+
+/* Asks the cache to load the sector that holds byte offset POS,
+ * which must be within INODE, in the background. */
+static void
+read_ahead (struct inode *inode, off_t pos) {
+	buffer_cache_read_ahead (byte_to_sector (inode, pos));
+}
+#else /* EFILESYS */
+
+/* Under EFILESYS an inode has a cluster to itself, and its data is
+ * the FAT chain that starts at cluster DATA.START, which is 0 for a
+ * file with no data.  CHAIN indexes that chain, so that seeking
+ * into the file does not walk the FAT from the start. */
+
+/* Returns the number of clusters in INODE's chain, and stores the
+ * last of them, or 0 if there is none, in *LASTP. */
+static size_t
+chain_length (struct inode *inode, cluster_t *lastp) {
+	cluster_t clst;
+	size_t cnt = 0;
+
+	*lastp = 0;
+	while ((clst = fat_index_seek (&inode->chain, cnt)) != 0) {
+		*lastp = clst;
+		cnt++;
+	}
+	return cnt;
+}
+
+/* Returns the disk sector that contains byte offset POS within
+ * INODE.
+ * Returns -1 if INODE does not contain data for a byte at offset
+ * POS. */
+static disk_sector_t
+byte_to_sector (struct inode *inode, off_t pos) {
+	ASSERT (inode != NULL);
+	if (pos < inode->data.length) {
+		size_t idx = pos / DISK_SECTOR_SIZE;
+		size_t spc = fat_sectors_per_cluster ();
+		cluster_t clst = fat_index_seek (&inode->chain, idx / spc);
+
+		if (clst != 0)
+			return cluster_to_sector (clst) + idx % spc;
+	}
+	return -1;
+}
+
+/* Returns the number of data sectors INODE has. */
+static size_t
+inode_sectors (struct inode *inode) {
+	cluster_t last;
+
+	return chain_length (inode, &last) * fat_sectors_per_cluster ();
+}
+
+/* Gives INODE at least SECTORS zeroed data sectors, a cluster at a
+ * time.  fat_create_chain() takes the cluster right after the last
+ * one while it is free, so files stay contiguous.  Returns false if
+ * the disk fills up; clusters added until then stay with INODE. */
+static bool
+inode_grow (struct inode *inode, size_t sectors) {
+	size_t spc = fat_sectors_per_cluster ();
+	cluster_t last;
+	size_t have = chain_length (inode, &last) * spc;
+
+	while (have < sectors) {
+		cluster_t clst = fat_create_chain (last);
+
+		if (clst == 0)
+			return false;
+		if (last == 0) {
+			inode->data.start = clst;
+			fat_index_init (&inode->chain, clst);
+		}
+		zero_sectors (cluster_to_sector (clst), spc);
+		last = clst;
+		have += spc;
+	}
+	return true;
+}
+
+/* Gives INODE's data clusters back to the FAT, except the inode's
+ * own. */
+static void
+release_data (struct inode *inode) {
+	if (inode->data.start != 0)
+		fat_remove_chain (inode->data.start, 0);
+}
+
+/* Writes INODE's length and first cluster to disk. */
+static void
+inode_store (struct inode *inode) {
+	buffer_cache_write (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+}
+
+/* Asks the cache to load the sectors from byte offset POS, which
+ * must be within INODE, to the end of its cluster in the background,
+ * unless that was asked already.  A cluster's sectors are
+ * consecutive, so a sequential reader gets each cluster read as a
+ * whole, while it is still busy with the one before. */
+static void
+read_ahead (struct inode *inode, off_t pos) {
+	size_t spc = fat_sectors_per_cluster ();
+	size_t idx = pos / DISK_SECTOR_SIZE;
+	size_t end = ROUND_UP (idx + 1, spc);
+	size_t file_end = bytes_to_sectors (inode_length (inode));
+	disk_sector_t sector;
+
+	if (inode->ra_end == end)
+		return;
+	inode->ra_end = end;
+	if (end > file_end)
+		end = file_end;
+	for (sector = byte_to_sector (inode, pos); idx < end; idx++)
+		buffer_cache_read_ahead (sector++);
+}
+
+/* Starts the index of the chain of the on-disk inode that was read
+ * into INODE->data.  Returns false unless its data is a FAT chain. */
+static bool
+load_data (struct inode *inode) {
+	fat_index_init (&inode->chain, inode->data.start);
+	return inode->data.magic == INODE_FAT_MAGIC;
+}
+#endif /* EFILESYS */
+
+/* Frees the in-memory INODE. */
+static void
+inode_free (struct inode *inode) {
+#ifndef EFILESYS
+	free (inode->ext);
+	free (inode->ext_first);
+#else
+	fat_index_destroy (&inode->chain);
+#endif
+	free (inode);
+}
+
+/* Allocates a sector for a new inode and stores it in *SECTORP.
+ * Under EFILESYS the inode gets a cluster to itself.  Returns false
+ * if the disk is full. */
+bool
+inode_sector_allocate (disk_sector_t *sectorp) {
+#ifdef EFILESYS
+	cluster_t clst = fat_create_chain (0);
+
+	if (clst == 0)
+		return false;
+	*sectorp = cluster_to_sector (clst);
+	return true;
+#else
+	return free_map_allocate (1, sectorp);
+#endif
+}
+
+/* Frees SECTOR, which inode_sector_allocate() returned. */
 void
-inode_init (void) {
-	list_init (&open_inodes);
+inode_sector_release (disk_sector_t sector) {
+#ifdef EFILESYS
+	fat_remove_chain (sector_to_cluster (sector), 0);
+#else
+	free_map_release (sector, 1);
+#endif
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -66,33 +467,32 @@ inode_init (void) {
  * Returns false if memory or disk allocation fails. */
 bool
 inode_create (disk_sector_t sector, off_t length) {
-	struct inode_disk *disk_inode = NULL;
-	bool success = false;
+	struct inode *inode;
+	bool success;
 
 	ASSERT (length >= 0);
 
 	/* If this assertion fails, the inode structure is not exactly
 	 * one sector in size, and you should fix that. */
-	ASSERT (sizeof *disk_inode == DISK_SECTOR_SIZE);
-
-	disk_inode = calloc (1, sizeof *disk_inode);
-	if (disk_inode != NULL) {
-		size_t sectors = bytes_to_sectors (length);
-		disk_inode->length = length;
-		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
-			if (sectors > 0) {
-				static char zeros[DISK_SECTOR_SIZE];
-				size_t i;
-
-				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
-			}
-			success = true; 
-		} 
-		free (disk_inode);
-	}
+	ASSERT (sizeof (struct inode_disk) == DISK_SECTOR_SIZE);
+
+	inode = calloc (1, sizeof *inode);
+	if (inode == NULL)
+		return false;
+	inode->sector = sector;
+#ifdef EFILESYS
+	inode->data.magic = INODE_FAT_MAGIC;
+	fat_index_init (&inode->chain, 0);
+#else
+	inode->data.magic = INODE_EXTENT_MAGIC;
+#endif
+	success = inode_grow (inode, bytes_to_sectors (length));
+	if (success) {
+		inode->data.length = length;
+		inode_store (inode);
+	} else
+		release_data (inode);
+	inode_free (inode);
 	return success;
 }
 
@@ -101,39 +501,60 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
+	struct inode key;
+	struct hash_elem *e;
 	struct inode *inode;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
+	key.sector = sector;
+	lock_acquire (&open_inodes_lock);
+	e = hash_find (&open_inodes, &key.elem);
+	if (e != NULL) {
+		inode = hash_entry (e, struct inode, elem);
+		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+		return inode;
 	}
+	lock_release (&open_inodes_lock);
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
+	inode = calloc (1, sizeof *inode);
 	if (inode == NULL)
 		return NULL;
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize.  The disk is read without the lock held. */
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
+	inode->write_gen = 0;
+	inode->read_next = -1;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	buffer_cache_read (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	if (!load_data (inode)) {
+		inode_free (inode);
+		return NULL;
+	}
+
+	/* Another thread may have opened it meanwhile. */
+	lock_acquire (&open_inodes_lock);
+	e = hash_insert (&open_inodes, &inode->elem);
+	if (e != NULL) {
+		inode_free (inode);
+		inode = hash_entry (e, struct inode, elem);
+		inode->open_cnt++;
+	}
+	lock_release (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -148,23 +569,27 @@ inode_get_inumber (const struct inode *inode) {
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	bool last;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
+	lock_acquire (&open_inodes_lock);
+	last = --inode->open_cnt == 0;
+	if (last)
+		hash_delete (&open_inodes, &inode->elem);
+	lock_release (&open_inodes_lock);
 
+	if (last) {
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
-			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
+			inode_sector_release (inode->sector);
+			release_data (inode);
 		}
 
-		free (inode); 
+		inode_free (inode);
 	}
 }
 
@@ -178,12 +603,14 @@ inode_remove (struct inode *inode) {
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
- * than SIZE if an error occurs or end of file is reached. */
+ * than SIZE if an error occurs or end of file is reached.
+ * A read that continues where the previous one stopped starts
+ * loading what comes after it in the background. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
+	bool sequential = offset == inode->read_next;
 
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
@@ -200,45 +627,50 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-		} else {
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		buffer_cache_read (sector_idx, buffer + bytes_read, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
-	free (bounce);
 
+	if (bytes_read > 0) {
+		off_t next = ROUND_UP (offset, DISK_SECTOR_SIZE);
+		if (sequential && next < inode_length (inode))
+			read_ahead (inode, next);
+		inode->read_next = offset;
+	}
 	return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * A write past end of file extends INODE, zero-filling any gap.
  * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+ * less than SIZE if the disk fills up or an error occurs. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
 
 	if (inode->deny_write_cnt)
 		return 0;
+	inode->write_gen++;
+
+	if (size > 0 && offset + size > inode_length (inode)) {
+		off_t end;
+
+		inode_grow (inode, bytes_to_sectors (offset + size));
+		end = (off_t) inode_sectors (inode) * DISK_SECTOR_SIZE;
+		if (end > offset + size)
+			end = offset + size;
+		if (end > inode_length (inode)) {
+			inode->data.length = end;
+			inode_store (inode);
+		}
+	}
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -255,34 +687,16 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-		} else {
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-
-			/* If the sector contains data before or after the chunk
-			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
-			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
-		}
+		/* The cache reads the sector in first unless the chunk
+		 * covers all of it. */
+		buffer_cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
-	free (bounce);
 
 	return bytes_written;
 }
@@ -311,3 +725,10 @@ off_t
 inode_length (const struct inode *inode) {
 	return inode->data.length;
 }
+
+/* Returns a counter that changes whenever INODE is written, so
+ * cached copies of its data can tell whether they are stale. */
+unsigned
+inode_write_gen (const struct inode *inode) {
+	return inode->write_gen;
+}
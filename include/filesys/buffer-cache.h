@@ -0,0 +1,17 @@
+#ifndef FILESYS_BUFFER_CACHE_H
+#define FILESYS_BUFFER_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/disk.h"
+
+void buffer_cache_init (void);
+void buffer_cache_read (disk_sector_t, void *, int ofs, int size);
+void buffer_cache_write (disk_sector_t, const void *, int ofs, int size);
+void buffer_cache_read_ahead (disk_sector_t);
+bool buffer_cache_holds (disk_sector_t);
+void buffer_cache_flush (void);
+void buffer_cache_flush_range (disk_sector_t, size_t cnt);
+void buffer_cache_print_stats (void);
+
+#endif /* filesys/buffer-cache.h */
@@ -15,7 +15,10 @@ typedef uint32_t cluster_t;  /* Index of a cluster within FAT. */
 
 /* Sectors of FAT information. */
 #define SECTORS_PER_CLUSTER 1 /* Number of sectors per cluster */
+#define SECTORS_PER_CLUSTER_LARGE 8 /* ...on disks of FAT_LARGE_DISK or more */
+#define FAT_LARGE_DISK (16 * 1024 * 1024 / DISK_SECTOR_SIZE)
 #define FAT_BOOT_SECTOR 0     /* FAT boot sector. */
+#define FAT_START_SECTOR 1    /* First sector of the FAT. */
 #define ROOT_DIR_CLUSTER 1    /* Cluster for the root directory */
 
 void fat_init (void);
@@ -34,5 +37,21 @@ void fat_remove_chain (
 cluster_t fat_get (cluster_t clst);
 void fat_put (cluster_t clst, cluster_t val);
 disk_sector_t cluster_to_sector (cluster_t clst);
+cluster_t sector_to_cluster (disk_sector_t sector);
+unsigned int fat_sectors_per_cluster (void);
+
+/* Lazily built array of the clusters of one chain, for seeking to
+ * the Nth cluster without walking the FAT from the start. */
+struct fat_index {
+	cluster_t start;        /* First cluster of the chain, or 0. */
+	cluster_t *clusters;    /* The first CNT clusters of the chain. */
+	size_t cnt;             /* Clusters known. */
+	size_t cap;             /* Room in CLUSTERS. */
+	unsigned gen;           /* Chain generation CLUSTERS is valid for. */
+};
+
+void fat_index_init (struct fat_index *, cluster_t start);
+void fat_index_destroy (struct fat_index *);
+cluster_t fat_index_seek (struct fat_index *, size_t n);
 
 #endif /* filesys/fat.h */
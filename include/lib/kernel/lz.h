@@ -0,0 +1,33 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Small LZ77-family compressor.
+
+   The encoded stream is a sequence of tokens.  A control byte
+   below 0x80 introduces a run of (control + 1) literal bytes.
+   A control byte of 0x80 or above introduces a back-reference
+   of (control & 0x7f) + LZ_MIN_MATCH bytes, followed by a 16-bit
+   little-endian distance. */
+
+/* Shortest and longest back-reference. */
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (0x7f + LZ_MIN_MATCH)
+
+/* Largest input lz_compress() accepts. */
+#define LZ_MAX_INPUT 0xfffe
+
+/* Bytes of scratch memory lz_compress() needs.  Kept off the
+   stack because kernel stacks are tiny. */
+#define LZ_HASH_BITS 10
+#define LZ_WORK_SIZE ((1 << LZ_HASH_BITS) * sizeof (uint16_t))
+
+size_t lz_compress (const void *src, size_t src_len,
+		void *dst, size_t dst_cap, void *work);
+bool lz_decompress (const void *src, size_t src_len,
+		void *dst, size_t dst_len);
+
+#endif /* lib/kernel/lz.h */
@@ -36,6 +36,13 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_MADVISE,                /* Give a memory access pattern hint. */
+	SYS_MSYNC,                  /* Write a mapping back to its file. */
+	SYS_SPAWN,                  /* Start a process without forking. */
+	SYS_SETRSSLIMIT,            /* Set the soft resident-set limit. */
+	SYS_GETRSS,                 /* Report resident and working set sizes. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -13,6 +13,27 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* ORed into mmap()'s WRITABLE argument: read the whole mapping in
+   right away instead of one page per fault. */
+#define MAP_POPULATE 0x2
+
+/* Access pattern hints for madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Expect random access: no read-ahead. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential access. */
+#define MADV_WILLNEED 3         /* Will be needed soon: load it now. */
+#define MADV_DONTNEED 4         /* Not needed: drop it from memory. */
+
+/* Flags for msync(). */
+#define MS_ASYNC 1              /* Schedule the write, return at once. */
+#define MS_INVALIDATE 2         /* Drop other cached copies. */
+#define MS_SYNC 4               /* Write before returning. */
+
+/* What get_rss() reports. */
+#define RSS_RESIDENT 0          /* Frames the process holds. */
+#define RSS_LIMIT 1             /* Its soft limit, 0 for none. */
+#define RSS_WORKING_SET 2       /* Frames it touched lately. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -26,6 +47,7 @@ void exit (int status) NO_RETURN;
 pid_t fork (const char *thread_name);
 int exec (const char *file);
 int wait (pid_t);
+pid_t spawn (const char *cmd_line, const int *fd_map); /* FD_MAP ends with -1. */
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
@@ -41,6 +63,10 @@ int dup2(int oldfd, int newfd);
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
+int msync (void *addr, size_t length, int flags);
+int set_rss_limit (size_t pages);
+long long get_rss (int what);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -78,4 +104,43 @@ get_fs_disk_write_cnt (void) {
 	return write_cnt;
 }
 
+/* Page fault classes for get_fault_cnt() and get_fault_hist(). */
+#define FAULT_LAZY_ANON 0       /* First touch of an anonymous page. */
+#define FAULT_LAZY_FILE 1       /* First touch of a page read from a file. */
+#define FAULT_STACK 2           /* First touch of a stack page. */
+#define FAULT_SWAP_IN 3         /* Evicted page brought back. */
+#define FAULT_COW 4             /* Write to a shared frame. */
+#define FAULT_WRITE_PROTECT 5   /* Write to a page only write-protected. */
+#define FAULT_INVALID 6         /* Bad access. */
+
+/* Returns how many faults of class TYPE this process has taken. */
+static inline long long
+get_fault_cnt (int type) {
+	long long cnt;
+	asm volatile ("int $0x45" : "=a" (cnt) : "a" ((long long) type) : "memory");
+	return cnt;
+}
+
+/* Returns how many faults of class TYPE, system-wide, took between
+   2^BUCKET and 2^(BUCKET+1) TSC cycles. */
+static inline long long
+get_fault_hist (int type, int bucket) {
+	long long cnt;
+	asm volatile ("int $0x46" : "=a" (cnt)
+			: "a" ((long long) type), "d" ((long long) bucket) : "memory");
+	return cnt;
+}
+
+/* What get_ksm_cnt() reports. */
+#define KSM_PAGES_SHARED 0      /* Merged frames in use. */
+#define KSM_PAGES_SAVED 1       /* Frames merging saves. */
+
+/* Returns the system-wide same-page merging count WHAT. */
+static inline long long
+get_ksm_cnt (int what) {
+	long long cnt;
+	asm volatile ("int $0x47" : "=a" (cnt) : "a" ((long long) what) : "memory");
+	return cnt;
+}
+
 #endif /* lib/user/syscall.h */
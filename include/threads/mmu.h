@@ -6,6 +6,9 @@
 #include <stdint.h>
 #include "threads/pte.h"
 
+/* Size of a page mapped directly by a page directory entry. */
+#define HPGSIZE (1UL << PDXSHIFT)
+
 typedef bool pte_for_each_func(uint64_t *pte, void *va, void *aux);
 
 uint64_t *pml4e_walk(uint64_t *pml4, const uint64_t va, int create);
@@ -16,6 +19,9 @@ void pml4_activate(uint64_t *pml4);
 void *pml4_get_page(uint64_t *pml4, const void *upage);
 bool pml4_set_page(uint64_t *pml4, void *upage, void *kpage, bool rw);
 void pml4_clear_page(uint64_t *pml4, void *upage);
+void pml4_set_writable(uint64_t *pml4, void *upage, bool writable);
+bool pml4_set_huge_page(uint64_t *pml4, void *upage, void *kpage, bool rw);
+bool pml4_is_huge(uint64_t *pml4, const void *upage);
 bool pml4_is_dirty(uint64_t *pml4, const void *upage);
 void pml4_set_dirty(uint64_t *pml4, const void *upage, bool dirty);
 bool pml4_is_accessed(uint64_t *pml4, const void *upage);
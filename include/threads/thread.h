@@ -129,6 +129,7 @@ struct thread
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	size_t rss_limit; /* Soft limit on private frames, 0 for none. */
 #endif
 
 	/* Owned by thread.c. */
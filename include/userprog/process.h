@@ -3,16 +3,9 @@
 
 #include "threads/thread.h"
 
-struct file_meta_data
-{
-	struct file *file;
-	off_t ofs;
-	uint32_t page_read_bytes;
-	uint32_t page_zero_bytes;
-};
-
 tid_t process_create_initd(const char *file_name);
 tid_t process_fork(const char *name, struct intr_frame *if_);
+tid_t process_spawn(char *cmd_line, const int *fds, int fd_cnt);
 int process_exec(void *f_name);
 int process_wait(tid_t);
 void process_exit(void);
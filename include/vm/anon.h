@@ -1,13 +1,21 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
+#include <stddef.h>
 #include "vm/vm.h"
 struct page;
 enum vm_type;
 
+/* Slot value of an anonymous page that is not swapped out. */
+#define SWAP_SLOT_NONE ((size_t) -1)
+
 struct anon_page {
+	size_t swap_slot;           /* Swap slot holding the page, or SWAP_SLOT_NONE. */
+	bool from_file;             /* First loaded from the executable. */
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void swap_slot_write (size_t slot, const void *kva);
+void anon_discard (struct page *page);
 
 #endif
@@ -0,0 +1,27 @@
+#ifndef VM_FAULTSTAT_H
+#define VM_FAULTSTAT_H
+#include <stdint.h>
+
+/* What a page fault turned out to be.  The values match FAULT_* of
+ * lib/user/syscall.h. */
+enum fault_class
+{
+	FAULT_LAZY_ANON,	 /* First touch of an anonymous page. */
+	FAULT_LAZY_FILE,	 /* First touch of a page read from a file. */
+	FAULT_STACK,		 /* First touch of a stack page. */
+	FAULT_SWAP_IN,		 /* Evicted page brought back. */
+	FAULT_COW,			 /* Write to a shared frame. */
+	FAULT_WRITE_PROTECT, /* Write to a page only write-protected. */
+	FAULT_INVALID,		 /* Bad access; the process is killed. */
+	FAULT_CLASS_CNT
+};
+
+/* Latency histogram buckets: bucket i counts faults that took
+ * [2^i, 2^(i+1)) TSC cycles, the last one everything longer. */
+#define FAULT_HIST_BUCKETS 32
+
+void fault_stat_init(void);
+void fault_stat_record(enum fault_class class, uint64_t cycles);
+void fault_stat_print(void);
+
+#endif /* vm/faultstat.h */
@@ -6,12 +6,34 @@
 struct page;
 enum vm_type;
 
+/* msync() flags.  Match MS_* of lib/user/syscall.h. */
+#define VM_MS_ASYNC 1           /* Leave the write to the flusher. */
+#define VM_MS_INVALIDATE 2      /* Accepted; no other copies to drop. */
+#define VM_MS_SYNC 4            /* Write before returning. */
+
+/* Where a lazily loaded page comes from.  This is the uninit aux of
+ * every page marked VM_MARKER_1: ELF segment pages and mmap pages. */
+struct file_meta_data
+{
+	struct file *file;
+	off_t ofs;
+	uint32_t page_read_bytes;
+	uint32_t page_zero_bytes;
+};
+
 struct file_page {
+	struct file_meta_data meta; /* Must stay first; see page_file_meta(). */
+	void *map_addr;             /* First page of the mapping. */
 };
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool file_backed_fork (struct page *src);
+void file_backed_discard (struct page *page);
+size_t file_write_back_all (void);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+bool do_msync (void *addr, size_t length);
+void file_print_stats (void);
 #endif
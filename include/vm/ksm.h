@@ -0,0 +1,22 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct frame;
+
+/* Pages ksmd examines per wakeup; 0 disables merging.  Set with
+ * the -ksm=PAGES kernel option. */
+extern size_t ksm_pages_to_scan;
+
+/* Same-page merging of anonymous frames.
+ * Called with the frame table lock held except ksm_init(). */
+void ksm_init(void);
+void ksm_forget(struct frame *frame);
+void ksm_get(struct frame *frame);
+void ksm_put(struct frame *frame);
+void ksm_unshare(struct frame *frame);
+bool ksm_evict(struct frame *frame);
+void ksm_print_stats(void);
+
+#endif /* vm/ksm.h */
@@ -0,0 +1,17 @@
+#ifndef VM_KSWAPD_H
+#define VM_KSWAPD_H
+#include <stddef.h>
+
+/* Free user frames below which kswapd wakes up, and the level it
+ * reclaims up to.  Left at SIZE_MAX, they are sized to the user
+ * pool.  Set with the -kswapd-low=PAGES and -kswapd-high=PAGES
+ * kernel options; a low watermark of 0 disables kswapd. */
+extern size_t kswapd_low_wmark;
+extern size_t kswapd_high_wmark;
+
+/* Background reclaim of user frames. */
+void kswapd_init(void);
+void kswapd_wake(void);
+void kswapd_print_stats(void);
+
+#endif /* vm/kswapd.h */
@@ -0,0 +1,14 @@
+#ifndef VM_LAUNCH_H
+#define VM_LAUNCH_H
+
+struct file;
+struct supplemental_page_table;
+
+/* Startup fault traces of executables, replayed on exec. */
+void launch_init(void);
+void launch_prefetch(struct file *exe);
+void launch_record(struct supplemental_page_table *spt, void *va);
+void launch_stop(struct supplemental_page_table *spt);
+void launch_print_stats(void);
+
+#endif /* vm/launch.h */
@@ -0,0 +1,12 @@
+#ifndef VM_RSS_H
+#define VM_RSS_H
+#include <stddef.h>
+
+struct supplemental_page_table;
+
+/* Working-set estimates of processes, sampled in the background. */
+void rss_init(void);
+size_t rss_working_set(struct supplemental_page_table *spt);
+void rss_print_stats(void);
+
+#endif /* vm/rss.h */
@@ -0,0 +1,23 @@
+#ifndef VM_TEXT_H
+#define VM_TEXT_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct frame;
+struct inode;
+
+/* Frames of read-only executable segments, shared by every process
+ * running the same binary and keyed by (inode, offset, bytes read).
+ * Called with the frame table lock held except text_cache_init(). */
+void text_cache_init(void);
+struct frame *text_cache_lookup(struct inode *inode, off_t ofs, uint32_t read_bytes);
+bool text_cache_insert(struct frame *frame, struct inode *inode, off_t ofs,
+					   uint32_t read_bytes);
+void text_cache_put(struct frame *frame);
+void text_cache_source(struct frame *frame, off_t *ofs, uint32_t *read_bytes);
+struct frame *text_cache_evict(struct frame *frame);
+struct frame *text_cache_reclaim(void);
+void text_cache_print_stats(void);
+
+#endif /* vm/text.h */
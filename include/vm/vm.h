@@ -1,8 +1,9 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <stdint.h>
+#include <list.h>
 #include "threads/palloc.h"
-#include "hash.h"
 
 enum vm_type
 {
@@ -20,7 +21,7 @@ enum vm_type
 	/* Auxillary bit flag marker for store information. You can add more
 	 * markers, until the value is fit in the int. */
 	VM_MARKER_0 = (1 << 3), // 스택이 저장된 메모리 페이지 식별
-	VM_MARKER_1 = (1 << 4),
+	VM_MARKER_1 = (1 << 4), // 파일에서 lazy load되는 페이지 (aux: struct file_meta_data)
 
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
@@ -29,15 +30,38 @@ enum vm_type
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/faultstat.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
 
 struct page_operations;
 struct thread;
+struct launch_trace;
 
 #define VM_TYPE(type) ((type)&7)
 
+/* Access pattern hints given with madvise().  The values match the
+ * MADV_* constants of lib/user/syscall.h.  Only the first three are
+ * remembered per page; the others act once on the range. */
+enum vm_advice
+{
+	VM_ADV_NORMAL = 0,	   /* Default read-ahead. */
+	VM_ADV_RANDOM = 1,	   /* No read-ahead. */
+	VM_ADV_SEQUENTIAL = 2, /* Full read-ahead, reclaim behind. */
+	VM_ADV_WILLNEED = 3,   /* Load the range now. */
+	VM_ADV_DONTNEED = 4,   /* Drop the range's frames now. */
+};
+
+/* mmap() flag ORed into WRITABLE: load every page up front.  Matches
+ * MAP_POPULATE of lib/user/syscall.h. */
+#define VM_MAP_POPULATE 0x2
+
+/* What get_rss() reports.  Match RSS_* of lib/user/syscall.h. */
+#define VM_RSS_RESIDENT 0
+#define VM_RSS_LIMIT 1
+#define VM_RSS_WORKING_SET 2
+
 /* The representation of "page".
  * This is kind of "parent class", which has four "child class"es, which are
  * uninit_page, file_page, anon_page, and page cache (project4).
@@ -49,8 +73,10 @@ struct page
 	struct frame *frame; /* Back reference for frame */
 
 	/* Your implementation */
-	struct hash_elem hash_elem;
 	bool writable;
+	struct thread *owner; /* Process whose pml4 maps VA. */
+	uint8_t advice;		  /* enum vm_advice, NORMAL to SEQUENTIAL. */
+	struct list_elem rmap_elem; /* Element in the frame's rmap while mapped. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -69,7 +95,18 @@ struct page
 struct frame
 {
 	void *kva;
-	struct page *page;
+	struct page *page;			 /* Owning page, NULL while shared. */
+	struct list_elem frame_elem; /* Element in the frame table. */
+	unsigned share_cnt;			 /* Pages mapping a shared frame, 0 if private. */
+	uint64_t checksum;			 /* Contents hash as of the last KSM scan. */
+	struct list_elem ksm_elem;	 /* Element in the KSM unstable table, or
+									in a stable bucket while merged. */
+	bool ksm_candidate;			 /* True while in the unstable table. */
+	struct text_entry *text;	 /* Shared text cache entry, if any. */
+	struct list rmap;			 /* Pages mapping this frame, each standing
+									for the (pml4, va) pair of its owner. */
+	bool clock_referenced;		 /* Accessed, as seen by the sampler only. */
+	bool sample_referenced;		 /* Accessed, as seen by the clock only. */
 };
 
 /* The function table for page operations.
@@ -95,7 +132,16 @@ struct page_operations
  * All designs up to you for this. */
 struct supplemental_page_table
 {
-	struct hash spt_hash;
+	void *root;		   /* Radix tree of pages keyed by VPN, shaped like
+						  the pml4: 4 levels of 512 slots. */
+	void *ra_next;	   /* Fault address that would continue a sequential stream. */
+	unsigned ra_streak; /* Consecutive sequential file faults so far. */
+	long long fault_cnt[FAULT_CLASS_CNT]; /* Faults of this process by class. */
+	struct launch_trace *launch;		  /* Startup trace being recorded, if any. */
+	size_t rss;							  /* Private frames in the frame table. */
+	size_t wss;							  /* Frames touched in the last full sample. */
+	size_t wss_cur;						  /* Frames touched so far in sample wss_epoch. */
+	unsigned wss_epoch;					  /* Sample wss_cur belongs to. */
 };
 
 #include "threads/thread.h"
@@ -107,6 +153,8 @@ struct page *spt_find_page(struct supplemental_page_table *spt,
 						   void *va);
 bool spt_insert_page(struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page);
+typedef bool spt_action_func(struct page *page, void *aux);
+bool spt_for_each(struct supplemental_page_table *spt, spt_action_func *action, void *aux);
 
 void vm_init(void);
 bool vm_try_handle_fault(struct intr_frame *f, void *addr, bool user,
@@ -118,7 +166,23 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
 									bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page(struct page *page);
 bool vm_claim_page(void *va);
+void vm_free_frame(struct page *page);
+size_t vm_prefetch(void *addr, size_t length, bool may_evict);
+bool vm_advise(void *addr, size_t length, enum vm_advice advice);
+void vm_frame_lock_acquire(void);
+void vm_frame_lock_release(void);
+struct frame *vm_frame_scan_next(bool *wrapped);
+struct frame *vm_frame_flush_next(bool *wrapped);
+struct frame *vm_frame_sample_next(bool *wrapped);
+void vm_frame_detach(struct frame *frame);
+void vm_frame_share(struct frame *frame);
+void vm_frame_link(struct frame *frame, struct page *page);
+void vm_frame_unlink(struct frame *frame, struct page *page);
+bool vm_frame_test_accessed(struct frame *frame);
+bool vm_frame_sample_accessed(struct frame *frame);
+void vm_set_rss_limit(struct thread *t, size_t limit);
+bool vm_reclaim_frame(void);
 enum vm_type page_get_type(struct page *page);
-void hash_page_destroy(struct hash_elem *e, void *aux);
+void vm_print_stats(void);
 
 #endif /* VM_VM_H */
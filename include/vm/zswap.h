@@ -0,0 +1,14 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Compressed in-RAM cache in front of the swap disk.
+ * Pages are keyed by the swap slot they were assigned. */
+void zswap_init(void);
+bool zswap_store(size_t slot, const void *kva);
+bool zswap_load(size_t slot, void *kva);
+void zswap_invalidate(size_t slot);
+void zswap_print_stats(void);
+
+#endif /* vm/zswap.h */
@@ -263,21 +263,55 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 
 /* Finding set or unset bits. */
 
+/* Returns the element of B that contains bit I, with the bits set
+   to VALUE turned on and shifted down so that bit I is bit 0. */
+static inline elem_type
+matches_from (const struct bitmap *b, size_t i, bool value) {
+	elem_type e = b->bits[elem_idx (i)];
+	return (value ? e : ~e) >> (i % ELEM_BITS);
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Works a whole element at a time: each step either extends the
+   current run by every matching bit up to the next mismatch, or
+   skips every mismatching bit up to the next match, so runs of
+   elements that hold no match cost one step apiece. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
+	size_t run = 0;     /* Matching bits just before I. */
+	size_t i = start;
+
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
-	if (cnt <= b->bit_cnt) {
-		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
-				return i;
+	if (cnt > b->bit_cnt)
+		return BITMAP_ERROR;
+	if (cnt == 0)
+		return start;
+
+	while (i < b->bit_cnt) {
+		elem_type m = matches_from (b, i, value);
+		size_t n = ~m == 0 ? ELEM_BITS : (size_t) __builtin_ctzl (~m);
+
+		if (n > b->bit_cnt - i)
+			n = b->bit_cnt - i;
+		run += n;
+		i += n;
+		if (run >= cnt)
+			return i - run;
+
+		/* Stopped at a mismatch rather than at the end of the
+		   element: skip it and the mismatches after it. */
+		if (i < b->bit_cnt && (n == 0 || i % ELEM_BITS != 0)) {
+			m = matches_from (b, i, value);
+			i += m == 0 ? ELEM_BITS - i % ELEM_BITS
+			            : (size_t) __builtin_ctzl (m);
+			run = 0;
+		}
 	}
 	return BITMAP_ERROR;
 }
@@ -326,6 +360,23 @@ bitmap_write (const struct bitmap *b, struct file *file) {
 	off_t size = byte_cnt (b->bit_cnt);
 	return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the SIZE bytes at offset OFS of B's file image, as written
+   by bitmap_write(), to the same place in FILE.  The range is cut
+   off at the end of the image.  Return true if successful, false
+   otherwise. */
+bool
+bitmap_write_part (const struct bitmap *b, struct file *file,
+		off_t ofs, off_t size) {
+	off_t file_size = byte_cnt (b->bit_cnt);
+
+	if (ofs >= file_size)
+		return true;
+	if (size > file_size - ofs)
+		size = file_size - ofs;
+	return file_write_at (file, (const uint8_t *) b->bits + ofs, size, ofs)
+		== size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -0,0 +1,128 @@
+#include "lz.h"
+#include <debug.h>
+#include <string.h>
+
+/* LZ77 compressor in the spirit of LZF/LZ4.  Its only sizable
+   state is the match-finder table, which the caller passes in as
+   WORK so that it stays off the kernel stack.  See lz.h for the
+   stream format. */
+
+/* Longest literal run a single control byte can describe. */
+#define LZ_MAX_LITERALS 0x80
+
+/* Marks an empty slot in the match-finder hash table. */
+#define LZ_NO_POS 0xffff
+
+/* Hashes the three bytes at P into the match-finder table. */
+static inline size_t
+hash3 (const uint8_t *p) {
+	uint32_t v = p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16);
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Emits SRC[START...END) as literal runs into DST at *OP.
+   Returns false if DST_CAP would be exceeded. */
+static bool
+put_literals (const uint8_t *src, size_t start, size_t end,
+		uint8_t *dst, size_t *op, size_t dst_cap) {
+	while (start < end) {
+		size_t run = end - start;
+		if (run > LZ_MAX_LITERALS)
+			run = LZ_MAX_LITERALS;
+		if (*op + 1 + run > dst_cap)
+			return false;
+		dst[(*op)++] = run - 1;
+		memcpy (dst + *op, src + start, run);
+		*op += run;
+		start += run;
+	}
+	return true;
+}
+
+/* Compresses SRC_LEN bytes from SRC into DST, which has room for
+   DST_CAP bytes.  WORK must point to LZ_WORK_SIZE bytes of
+   scratch memory.
+   Returns the compressed size, or 0 if the output did not fit
+   in DST_CAP bytes. */
+size_t
+lz_compress (const void *src_, size_t src_len,
+		void *dst_, size_t dst_cap, void *work) {
+	const uint8_t *src = src_;
+	uint8_t *dst = dst_;
+	uint16_t *table = work;
+	size_t ip = 0, op = 0, lit_start = 0;
+
+	ASSERT (src_len <= LZ_MAX_INPUT);
+	memset (table, 0xff, LZ_WORK_SIZE);
+
+	while (ip + LZ_MIN_MATCH <= src_len) {
+		size_t h = hash3 (src + ip);
+		size_t ref = table[h];
+		table[h] = ip;
+
+		if (ref != LZ_NO_POS && src[ref] == src[ip]
+				&& src[ref + 1] == src[ip + 1] && src[ref + 2] == src[ip + 2]) {
+			size_t max = src_len - ip;
+			size_t len = LZ_MIN_MATCH;
+			size_t dist = ip - ref;
+
+			if (max > LZ_MAX_MATCH)
+				max = LZ_MAX_MATCH;
+			while (len < max && src[ref + len] == src[ip + len])
+				len++;
+
+			if (!put_literals (src, lit_start, ip, dst, &op, dst_cap)
+					|| op + 3 > dst_cap)
+				return 0;
+			dst[op++] = 0x80 | (len - LZ_MIN_MATCH);
+			dst[op++] = dist & 0xff;
+			dst[op++] = dist >> 8;
+
+			ip += len;
+			lit_start = ip;
+		} else
+			ip++;
+	}
+
+	if (!put_literals (src, lit_start, src_len, dst, &op, dst_cap))
+		return 0;
+	return op;
+}
+
+/* Decompresses SRC_LEN bytes of SRC into exactly DST_LEN bytes
+   at DST.  Returns false if SRC is malformed or does not expand
+   to exactly DST_LEN bytes. */
+bool
+lz_decompress (const void *src_, size_t src_len, void *dst_, size_t dst_len) {
+	const uint8_t *src = src_;
+	uint8_t *dst = dst_;
+	size_t ip = 0, op = 0;
+
+	while (ip < src_len) {
+		uint8_t ctrl = src[ip++];
+
+		if (ctrl < 0x80) {
+			size_t run = ctrl + 1;
+			if (ip + run > src_len || op + run > dst_len)
+				return false;
+			memcpy (dst + op, src + ip, run);
+			ip += run;
+			op += run;
+		} else {
+			size_t len = (ctrl & 0x7f) + LZ_MIN_MATCH;
+			size_t dist;
+
+			if (ip + 2 > src_len)
+				return false;
+			dist = src[ip] | (src[ip + 1] << 8);
+			ip += 2;
+			if (dist == 0 || dist > op || op + len > dst_len)
+				return false;
+
+			/* Byte at a time: the reference may overlap the output. */
+			for (; len > 0; len--, op++)
+				dst[op] = dst[op - dist];
+		}
+	}
+	return op == dst_len;
+}
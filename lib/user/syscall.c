@@ -96,6 +96,11 @@ int wait(pid_t pid)
 	return syscall1(SYS_WAIT, pid);
 }
 
+pid_t spawn(const char *cmd_line, const int *fd_map)
+{
+	return (pid_t)syscall2(SYS_SPAWN, cmd_line, fd_map);
+}
+
 bool create(const char *file, unsigned initial_size)
 {
 	return syscall2(SYS_CREATE, file, initial_size);
@@ -158,6 +163,26 @@ void munmap(void *addr)
 	syscall1(SYS_MUNMAP, addr);
 }
 
+int madvise(void *addr, size_t length, int advice)
+{
+	return syscall3(SYS_MADVISE, addr, length, advice);
+}
+
+int msync(void *addr, size_t length, int flags)
+{
+	return syscall3(SYS_MSYNC, addr, length, flags);
+}
+
+int set_rss_limit(size_t pages)
+{
+	return syscall1(SYS_SETRSSLIMIT, pages);
+}
+
+long long get_rss(int what)
+{
+	return syscall1(SYS_GETRSS, what);
+}
+
 bool chdir(const char *dir)
 {
 	return syscall1(SYS_CHDIR, dir);
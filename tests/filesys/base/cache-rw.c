@@ -0,0 +1,63 @@
+/* Checks the buffer cache through the file system disk's read and
+   write counters.  Reading back a small file that was just written
+   hits the cache, many small writes to it reach the disk at most
+   once per sector, and after a large file pushes it out of the
+   cache, reading it again misses and finds what was written. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE 4096
+#define BIG_SIZE (128 * 512)
+
+static char buf[TEST_SIZE];
+
+void
+test_main (void) 
+{
+  long long read_cnt, write_cnt;
+  int fd, big_fd, i;
+  char c;
+
+  CHECK (create ("data", TEST_SIZE), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == TEST_SIZE, "write \"data\"");
+
+  read_cnt = get_fs_disk_read_cnt ();
+  write_cnt = get_fs_disk_write_cnt ();
+  for (i = 0; i < TEST_SIZE; i++) 
+    {
+      seek (fd, i);
+      if (read (fd, &c, 1) != 1 || c != buf[i])
+        fail ("byte %d of \"data\" differs", i);
+      c = 'a';
+      seek (fd, i);
+      write (fd, &c, 1);
+    }
+  CHECK (get_fs_disk_read_cnt () == read_cnt, "reads hit the cache");
+  CHECK (get_fs_disk_write_cnt () <= write_cnt + TEST_SIZE / 512,
+         "writes are deferred");
+
+  /* Twice the size of the cache. */
+  CHECK (create ("big", BIG_SIZE), "create \"big\"");
+  CHECK ((big_fd = open ("big")) > 1, "open \"big\"");
+  for (i = 0; i < BIG_SIZE / TEST_SIZE; i++)
+    if (write (big_fd, buf, sizeof buf) != TEST_SIZE)
+      fail ("write \"big\" failed");
+  close (big_fd);
+
+  read_cnt = get_fs_disk_read_cnt ();
+  seek (fd, 0);
+  CHECK (read (fd, buf, sizeof buf) == TEST_SIZE, "read \"data\" again");
+  for (i = 0; i < TEST_SIZE; i++)
+    if (buf[i] != 'a')
+      fail ("byte %d of \"data\" lost its write", i);
+  CHECK (get_fs_disk_read_cnt () > read_cnt, "evicted sectors miss");
+
+  msg ("close \"data\"");
+  close (fd);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-rw) begin
+(cache-rw) create "data"
+(cache-rw) open "data"
+(cache-rw) write "data"
+(cache-rw) reads hit the cache
+(cache-rw) writes are deferred
+(cache-rw) create "big"
+(cache-rw) open "big"
+(cache-rw) read "data" again
+(cache-rw) evicted sectors miss
+(cache-rw) close "data"
+(cache-rw) end
+EOF
+pass;
@@ -0,0 +1,95 @@
+/* Directories written before the hashed format are flat arrays of
+   entries with no header.  Writes one by hand and checks that
+   lookup, readdir and add still work on it. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "filesys/directory.h"
+#include "filesys/inode.h"
+
+/* An entry of a flat directory, as it is on disk. */
+struct flat_entry 
+  {
+    disk_sector_t inode_sector;
+    char name[NAME_MAX + 1];
+    bool in_use;
+  };
+
+/* Returns the sector of a new empty inode. */
+static disk_sector_t
+make_inode (void) 
+{
+  disk_sector_t sector;
+
+  if (!inode_sector_allocate (&sector) || !inode_create (sector, 0))
+    fail ("can't create an inode");
+  return sector;
+}
+
+/* Checks that NAME is in DIR and is the inode in SECTOR. */
+static void
+check_lookup (struct dir *dir, const char *name, disk_sector_t sector) 
+{
+  struct inode *inode;
+
+  if (!dir_lookup (dir, name, &inode))
+    fail ("lookup of \"%s\" failed", name);
+  if (inode_get_inumber (inode) != sector)
+    fail ("\"%s\" is sector %u, not %u", name,
+          inode_get_inumber (inode), sector);
+  inode_close (inode);
+}
+
+void
+test_dir_flat (void) 
+{
+  static const char *names[] = {"alpha", "beta", "gamma"};
+  struct flat_entry entries[3];
+  char name[NAME_MAX + 1];
+  disk_sector_t delta;
+  struct inode *inode;
+  struct dir *dir;
+  int i, cnt;
+
+  /* "beta" was removed before the directory was ever read. */
+  memset (entries, 0, sizeof entries);
+  for (i = 0; i < 3; i++) 
+    {
+      entries[i].inode_sector = make_inode ();
+      strlcpy (entries[i].name, names[i], sizeof entries[i].name);
+      entries[i].in_use = i != 1;
+    }
+  inode = inode_open (make_inode ());
+  if (inode == NULL
+      || inode_write_at (inode, entries, sizeof entries, 0) != sizeof entries)
+    fail ("can't write the flat directory");
+  dir = dir_open (inode);
+  if (dir == NULL)
+    fail ("can't open the flat directory");
+
+  check_lookup (dir, "alpha", entries[0].inode_sector);
+  check_lookup (dir, "gamma", entries[2].inode_sector);
+  if (dir_lookup (dir, "beta", &inode))
+    fail ("found the removed entry");
+  msg ("looked up flat entries");
+
+  for (cnt = 0; dir_readdir (dir, name); cnt++)
+    if (strcmp (name, names[cnt == 0 ? 0 : 2]))
+      fail ("listed \"%s\" at position %d", name, cnt);
+  if (cnt != 2)
+    fail ("listed %d names, not 2", cnt);
+  msg ("listed flat entries");
+
+  /* The free slot is reused rather than the file growing. */
+  delta = make_inode ();
+  if (!dir_add (dir, "delta", delta))
+    fail ("add to the flat directory failed");
+  if (inode_length (dir_get_inode (dir)) != sizeof entries)
+    fail ("adding grew the flat directory");
+  check_lookup (dir, "delta", delta);
+  msg ("added a flat entry");
+
+  dir_close (dir);
+  pass ();
+}
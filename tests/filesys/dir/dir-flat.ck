@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dir-flat) begin
+(dir-flat) looked up flat entries
+(dir-flat) listed flat entries
+(dir-flat) added a flat entry
+(dir-flat) PASS
+(dir-flat) end
+EOF
+pass;
@@ -0,0 +1,65 @@
+/* Creates enough files in the root directory to grow it past one
+   bucket a few times, then checks that every file can still be
+   found, that none can be added twice, and that removing half of
+   them leaves the other half in place. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+
+#define FILE_CNT 100
+
+void
+test_dir_grow (void) 
+{
+  char name[NAME_MAX + 1];
+  struct dir *root;
+  struct file *file;
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!filesys_create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+
+  root = dir_open_root ();
+  if (inode_length (dir_get_inode (root)) <= 2 * DISK_SECTOR_SIZE)
+    fail ("root directory did not grow past one bucket");
+  dir_close (root);
+  msg ("created %d files", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      file = filesys_open (name);
+      if (file == NULL)
+        fail ("open \"%s\" failed", name);
+      file_close (file);
+      if (filesys_create (name, 0))
+        fail ("created \"%s\" twice", name);
+    }
+  msg ("found every file");
+
+  for (i = 0; i < FILE_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!filesys_remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      file = filesys_open (name);
+      if ((file != NULL) != (i % 2 != 0))
+        fail ("\"%s\" %s after removing", name,
+              file != NULL ? "still there" : "missing");
+      file_close (file);
+    }
+  msg ("removed every other file");
+  pass ();
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dir-grow) begin
+(dir-grow) created 100 files
+(dir-grow) found every file
+(dir-grow) removed every other file
+(dir-grow) PASS
+(dir-grow) end
+EOF
+pass;
@@ -0,0 +1,91 @@
+/* Reads the root directory through a handle opened before it grew.
+   A fresh listing must name every file exactly once.  A listing
+   that was partway through when the directory grew may see names
+   again but must still end and name only real files. */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "filesys/directory.h"
+#include "filesys/filesys.h"
+
+#define FILE_CNT 100
+#define FIRST_CNT 20
+
+/* Returns the number in NAME, which must be a file this test
+   created. */
+static int
+file_number (const char *name) 
+{
+  int i;
+
+  if (memcmp (name, "file", 4) || (i = atoi (name + 4)) < 0
+      || i >= FILE_CNT)
+    fail ("unexpected name \"%s\"", name);
+  return i;
+}
+
+static void
+create_files (unsigned first, unsigned last) 
+{
+  char name[NAME_MAX + 1];
+  unsigned i;
+
+  for (i = first; i < last; i++)
+    {
+      snprintf (name, sizeof name, "file%u", i);
+      if (!filesys_create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+}
+
+void
+test_dir_readdir_grow (void) 
+{
+  static bool seen[FILE_CNT];
+  char name[NAME_MAX + 1];
+  struct dir *fresh, *partial;
+  int i, cnt;
+
+  fresh = dir_open_root ();
+  partial = dir_open_root ();
+  if (fresh == NULL || partial == NULL)
+    fail ("can't open the root directory");
+
+  /* One bucket holds all of these. */
+  create_files (0, FIRST_CNT);
+  for (i = 0; i < FIRST_CNT / 2; i++) 
+    {
+      if (!dir_readdir (partial, name))
+        fail ("listing ended after %d of %d names", i, FIRST_CNT);
+      file_number (name);
+    }
+
+  create_files (FIRST_CNT, FILE_CNT);
+  msg ("grew the root directory to %d files", FILE_CNT);
+
+  for (cnt = 0; dir_readdir (fresh, name); cnt++) 
+    {
+      i = file_number (name);
+      if (seen[i])
+        fail ("\"%s\" listed twice", name);
+      seen[i] = true;
+    }
+  if (cnt != FILE_CNT)
+    fail ("listed %d of %d files", cnt, FILE_CNT);
+  msg ("fresh listing named every file once");
+
+  for (cnt = 0; dir_readdir (partial, name); cnt++) 
+    {
+      file_number (name);
+      if (cnt > 2 * FILE_CNT)
+        fail ("listing did not end");
+    }
+  msg ("partial listing ended");
+
+  dir_close (partial);
+  dir_close (fresh);
+  pass ();
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dir-readdir-grow) begin
+(dir-readdir-grow) grew the root directory to 100 files
+(dir-readdir-grow) fresh listing named every file once
+(dir-readdir-grow) partial listing ended
+(dir-readdir-grow) PASS
+(dir-readdir-grow) end
+EOF
+pass;
@@ -0,0 +1,86 @@
+/* Allocates FAT chains directly and through a file, and checks
+   that chains are linked as asked, stay contiguous while they can,
+   and give all of their clusters back when removed. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "filesys/fat.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+
+/* Returns the number of free clusters, by taking all of them as one
+   chain and giving them back. */
+static size_t
+free_clusters (void) 
+{
+  cluster_t first, clst;
+  size_t cnt;
+
+  first = clst = fat_create_chain (0);
+  if (first == 0)
+    return 0;
+  for (cnt = 1; (clst = fat_create_chain (clst)) != 0; cnt++)
+    continue;
+  fat_remove_chain (first, 0);
+  return cnt;
+}
+
+void
+test_fat_alloc (void) 
+{
+  size_t file_size = 3 * fat_sectors_per_cluster () * DISK_SECTOR_SIZE;
+  cluster_t a, b, c, d, inode_clst;
+  size_t cnt;
+  struct file *file;
+
+  /* A chain grows into the cluster after its end while that one is
+     free, and around it once it is taken. */
+  a = fat_create_chain (0);
+  b = fat_create_chain (a);
+  if (a == 0 || b != a + 1)
+    fail ("chain %u -> %u is not contiguous", a, b);
+  c = fat_create_chain (0);
+  d = fat_create_chain (b);
+  if (c == 0 || d == 0 || d == c)
+    fail ("chain %u grew into chain %u", a, c);
+  if (fat_get (a) != b || fat_get (b) != d || fat_get (d) != EOChain
+      || fat_get (c) != EOChain)
+    fail ("chains are linked wrong");
+  msg ("allocated two chains");
+
+  fat_remove_chain (a, 0);
+  fat_remove_chain (c, 0);
+  if (fat_get (a) != 0 || fat_get (b) != 0 || fat_get (c) != 0
+      || fat_get (d) != 0)
+    fail ("removed chains still hold clusters");
+  msg ("removed both chains");
+
+  /* Filling the disk twice gets the same clusters back, so the
+     search wraps around to the ones freed behind it. */
+  cnt = free_clusters ();
+  if (cnt == 0 || free_clusters () != cnt)
+    fail ("second fill got a different number of clusters");
+  msg ("filled the disk twice");
+
+  /* A file's inode and data come from the FAT and go back to it. */
+  if (!filesys_create ("a", file_size))
+    fail ("can't create \"a\"");
+  file = filesys_open ("a");
+  if (file == NULL)
+    fail ("can't open \"a\"");
+  inode_clst = sector_to_cluster (inode_get_inumber (file_get_inode (file)));
+  if (fat_get (inode_clst) != EOChain)
+    fail ("inode cluster %u is not allocated", inode_clst);
+  if (free_clusters () != cnt - 4)
+    fail ("file took %zu clusters, not 4", cnt - free_clusters ());
+  msg ("created a file");
+
+  if (!filesys_remove ("a"))
+    fail ("can't remove \"a\"");
+  file_close (file);
+  if (free_clusters () != cnt)
+    fail ("removed file kept %zu clusters", cnt - free_clusters ());
+  msg ("removed the file");
+  pass ();
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fat-alloc) begin
+(fat-alloc) allocated two chains
+(fat-alloc) removed both chains
+(fat-alloc) filled the disk twice
+(fat-alloc) created a file
+(fat-alloc) removed the file
+(fat-alloc) PASS
+(fat-alloc) end
+EOF
+pass;
@@ -0,0 +1,93 @@
+/* Grows two files a cluster at a time in turn, so their FAT chains
+   interleave, and checks that every cluster of each reads back
+   right, in order and backward, also after another chain is
+   removed under the files' chain indexes. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "filesys/fat.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+
+#define CLUSTERS 20
+
+/* Checks that cluster I of FILE, CLUSTER_SIZE bytes long, holds the
+   byte pattern of file NAME. */
+static void
+check_cluster (struct file *file, const char *name, int i,
+               size_t cluster_size, char *buf) 
+{
+  size_t j;
+
+  if (file_read_at (file, buf, cluster_size, i * cluster_size)
+      != (off_t) cluster_size)
+    fail ("short read of cluster %d of \"%s\"", i, name);
+  for (j = 0; j < cluster_size; j++)
+    if (buf[j] != (char) (name[0] + i))
+      fail ("cluster %d of \"%s\" holds %d at %zu", i, name, buf[j], j);
+}
+
+/* Checks every cluster of both FILES, first to last and then last
+   to first. */
+static void
+check_files (struct file *files[2], const char *names[2],
+             size_t cluster_size, char *buf) 
+{
+  int i, f;
+
+  for (i = 0; i < CLUSTERS; i++)
+    for (f = 0; f < 2; f++)
+      check_cluster (files[f], names[f], i, cluster_size, buf);
+  for (i = CLUSTERS - 1; i >= 0; i--)
+    for (f = 0; f < 2; f++)
+      check_cluster (files[f], names[f], i, cluster_size, buf);
+}
+
+void
+test_fat_chain (void) 
+{
+  static const char *names[2] = {"a", "b"};
+  size_t cluster_size = fat_sectors_per_cluster () * DISK_SECTOR_SIZE;
+  struct file *files[2];
+  char *buf;
+  int i, f;
+
+  buf = malloc (cluster_size);
+  if (buf == NULL)
+    fail ("out of memory");
+  for (f = 0; f < 2; f++) 
+    {
+      if (!filesys_create (names[f], 0))
+        fail ("can't create \"%s\"", names[f]);
+      files[f] = filesys_open (names[f]);
+      if (files[f] == NULL)
+        fail ("can't open \"%s\"", names[f]);
+    }
+
+  for (i = 0; i < CLUSTERS; i++)
+    for (f = 0; f < 2; f++) 
+      {
+        memset (buf, names[f][0] + i, cluster_size);
+        if (file_write (files[f], buf, cluster_size) != (off_t) cluster_size)
+          fail ("can't write cluster %d of \"%s\"", i, names[f]);
+      }
+  msg ("wrote %d clusters to each file", CLUSTERS);
+  check_files (files, names, cluster_size, buf);
+  msg ("read both files");
+
+  /* Removing a chain makes every index start over. */
+  if (!filesys_create ("c", cluster_size) || !filesys_remove ("c"))
+    fail ("can't create and remove \"c\"");
+  check_files (files, names, cluster_size, buf);
+  msg ("read both files after a removal");
+
+  for (f = 0; f < 2; f++) 
+    {
+      file_close (files[f]);
+      filesys_remove (names[f]);
+    }
+  free (buf);
+  pass ();
+}
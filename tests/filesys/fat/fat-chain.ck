@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fat-chain) begin
+(fat-chain) wrote 20 clusters to each file
+(fat-chain) read both files
+(fat-chain) read both files after a removal
+(fat-chain) PASS
+(fat-chain) end
+EOF
+pass;
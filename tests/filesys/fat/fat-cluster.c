@@ -0,0 +1,106 @@
+/* Reads a file a sector at a time on a disk with multi-sector
+   clusters, and checks that read-ahead loads the rest of the
+   cluster being read, and then the whole next cluster, before the
+   reader gets there. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+#include "filesys/buffer-cache.h"
+#include "filesys/fat.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+
+/* More sectors than the buffer cache holds. */
+#define FILLER_SECTORS 128
+
+/* Reads all of FILE a sector at a time. */
+static void
+read_all (struct file *file) 
+{
+  char buf[DISK_SECTOR_SIZE];
+  off_t ofs;
+
+  for (ofs = 0; ofs < file_length (file); ofs += DISK_SECTOR_SIZE)
+    file_read_at (file, buf, DISK_SECTOR_SIZE, ofs);
+}
+
+/* Creates file NAME, SIZE bytes long, and returns it open. */
+static struct file *
+create (const char *name, off_t size) 
+{
+  struct file *file;
+
+  if (!filesys_create (name, size))
+    fail ("can't create \"%s\"", name);
+  file = filesys_open (name);
+  if (file == NULL)
+    fail ("can't open \"%s\"", name);
+  return file;
+}
+
+/* Returns the number of sectors from SECTOR on, up to CNT, that the
+   cache holds. */
+static unsigned
+held (disk_sector_t sector, unsigned cnt) 
+{
+  unsigned i, n = 0;
+
+  for (i = 0; i < cnt; i++)
+    n += buffer_cache_holds (sector + i);
+  return n;
+}
+
+void
+test_fat_cluster (void) 
+{
+  unsigned spc = fat_sectors_per_cluster ();
+  char buf[DISK_SECTOR_SIZE];
+  struct file *file, *filler;
+  disk_sector_t first, second;
+  cluster_t start;
+  unsigned i;
+
+  if (spc == 1)
+    fail ("disk has one sector per cluster");
+  file = create ("a", 3 * spc * DISK_SECTOR_SIZE);
+  filler = create ("b", FILLER_SECTORS * DISK_SECTOR_SIZE);
+
+  /* An inode starts with its first data cluster. */
+  buffer_cache_read (inode_get_inumber (file_get_inode (file)), &start,
+                     0, sizeof start);
+  first = cluster_to_sector (start);
+  second = cluster_to_sector (fat_get (start));
+
+  /* Push "a" out of the cache. */
+  read_all (filler);
+  read_all (filler);
+  if (held (first, spc) != 0 || held (second, spc) != 0)
+    fail ("\"a\" is still cached");
+  msg ("emptied the cache of \"a\"");
+
+  /* The second read is sequential, so the rest of the first cluster
+     is read ahead. */
+  file_read_at (file, buf, DISK_SECTOR_SIZE, 0);
+  file_read_at (file, buf, DISK_SECTOR_SIZE, DISK_SECTOR_SIZE);
+  timer_sleep (TIMER_FREQ / 10);
+  if (held (first, spc) != spc)
+    fail ("%u of %u sectors of the first cluster are cached",
+          held (first, spc), spc);
+  msg ("read ahead the rest of the first cluster");
+
+  /* Reading its last sector reads ahead all of the next one. */
+  for (i = 2; i < spc; i++)
+    file_read_at (file, buf, DISK_SECTOR_SIZE, i * DISK_SECTOR_SIZE);
+  timer_sleep (TIMER_FREQ / 10);
+  if (held (second, spc) != spc)
+    fail ("%u of %u sectors of the second cluster are cached",
+          held (second, spc), spc);
+  msg ("read ahead the whole second cluster");
+
+  file_close (filler);
+  file_close (file);
+  pass ();
+}
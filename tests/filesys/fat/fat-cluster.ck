@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fat-cluster) begin
+(fat-cluster) emptied the cache of "a"
+(fat-cluster) read ahead the rest of the first cluster
+(fat-cluster) read ahead the whole second cluster
+(fat-cluster) PASS
+(fat-cluster) end
+EOF
+pass;
@@ -0,0 +1,71 @@
+/* Changes the FAT and reads its sectors straight from the disk,
+   past the buffer cache, to check that the FAT flusher writes the
+   changes within a few seconds, and that fat_close() writes them at
+   once. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/disk.h"
+#include "devices/timer.h"
+#include "filesys/fat.h"
+#include "filesys/filesys.h"
+
+/* Enough clusters that the chain spans several FAT sectors. */
+#define CLUSTERS 400
+
+#define ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (cluster_t))
+
+/* Returns the FAT entry for CLST as it is on disk. */
+static cluster_t
+disk_entry (cluster_t clst) 
+{
+  static cluster_t sector[ENTRIES_PER_SECTOR];
+
+  disk_read (filesys_disk, FAT_START_SECTOR + clst / ENTRIES_PER_SECTOR,
+             sector);
+  return sector[clst % ENTRIES_PER_SECTOR];
+}
+
+/* Checks that the disk has the same FAT entry as memory for every
+   cluster from FIRST to LAST. */
+static void
+check_disk (cluster_t first, cluster_t last) 
+{
+  cluster_t clst;
+
+  for (clst = first; clst <= last; clst++)
+    if (disk_entry (clst) != fat_get (clst))
+      fail ("cluster %u is %u on disk, not %u",
+            clst, disk_entry (clst), fat_get (clst));
+}
+
+void
+test_fat_flush (void) 
+{
+  cluster_t first, last, clst;
+  int i;
+
+  first = last = fat_create_chain (0);
+  for (i = 1; i < CLUSTERS; i++) 
+    {
+      clst = fat_create_chain (last);
+      if (clst == 0)
+        fail ("out of clusters");
+      last = clst;
+    }
+  if (last != first + CLUSTERS - 1)
+    fail ("chain is not contiguous");
+
+  /* Two intervals of the flusher, which runs every 5 seconds. */
+  timer_sleep (10 * TIMER_FREQ);
+  check_disk (first, last);
+  msg ("flusher wrote the new chain");
+
+  fat_remove_chain (first, 0);
+  fat_close ();
+  check_disk (first, last);
+  if (disk_entry (first) != 0)
+    fail ("removed chain is still on disk");
+  msg ("closing wrote the removal");
+  pass ();
+}
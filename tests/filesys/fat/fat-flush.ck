@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fat-flush) begin
+(fat-flush) flusher wrote the new chain
+(fat-flush) closing wrote the removal
+(fat-flush) PASS
+(fat-flush) end
+EOF
+pass;
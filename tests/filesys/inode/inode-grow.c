@@ -0,0 +1,120 @@
+/* Grows two files a sector at a time in turn, so that neither can
+   stay contiguous and each needs more extents than fit in its inode,
+   then extends one past a gap.  Every sector must read back right,
+   also after the files are closed and their inodes, extents and
+   all, are read from disk again. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "filesys/inode.h"
+
+/* More than the extents an inode holds by itself. */
+#define SECTORS 100
+
+/* Where the write past the gap goes, in sectors. */
+#define GAP_END (2 * SECTORS)
+
+/* Returns the byte that sector I of file F holds. */
+static char
+pattern (int f, int i) 
+{
+  return 'a' + f * 8 + i % 8;
+}
+
+/* Checks the first SECTORS sectors of INODE, which is file F. */
+static void
+check_sectors (struct inode *inode, int f) 
+{
+  char buf[DISK_SECTOR_SIZE];
+  int i, j;
+
+  for (i = 0; i < SECTORS; i++) 
+    {
+      if (inode_read_at (inode, buf, sizeof buf, i * DISK_SECTOR_SIZE)
+          != sizeof buf)
+        fail ("short read of sector %d of file %d", i, f);
+      for (j = 0; j < DISK_SECTOR_SIZE; j++)
+        if (buf[j] != pattern (f, i))
+          fail ("sector %d of file %d holds %d", i, f, buf[j]);
+    }
+}
+
+/* Checks that INODE has zeros from sector SECTORS up to GAP_END and
+   then one sector of 'z'. */
+static void
+check_gap (struct inode *inode) 
+{
+  char buf[DISK_SECTOR_SIZE];
+  int i, j;
+
+  if (inode_length (inode) != (GAP_END + 1) * DISK_SECTOR_SIZE)
+    fail ("file is %d bytes long", inode_length (inode));
+  for (i = SECTORS; i <= GAP_END; i++) 
+    {
+      char value = i < GAP_END ? 0 : 'z';
+
+      if (inode_read_at (inode, buf, sizeof buf, i * DISK_SECTOR_SIZE)
+          != sizeof buf)
+        fail ("short read of sector %d", i);
+      for (j = 0; j < DISK_SECTOR_SIZE; j++)
+        if (buf[j] != value)
+          fail ("sector %d holds %d, not %d", i, buf[j], value);
+    }
+}
+
+void
+test_inode_grow (void) 
+{
+  char buf[DISK_SECTOR_SIZE];
+  disk_sector_t sectors[2];
+  struct inode *inodes[2];
+  int i, f;
+
+  for (f = 0; f < 2; f++) 
+    {
+      if (!inode_sector_allocate (&sectors[f])
+          || !inode_create (sectors[f], 0))
+        fail ("can't create file %d", f);
+      inodes[f] = inode_open (sectors[f]);
+      if (inodes[f] == NULL)
+        fail ("can't open file %d", f);
+    }
+
+  for (i = 0; i < SECTORS; i++)
+    for (f = 0; f < 2; f++) 
+      {
+        memset (buf, pattern (f, i), sizeof buf);
+        if (inode_write_at (inodes[f], buf, sizeof buf, i * DISK_SECTOR_SIZE)
+            != sizeof buf)
+          fail ("can't write sector %d of file %d", i, f);
+      }
+  for (f = 0; f < 2; f++)
+    check_sectors (inodes[f], f);
+  msg ("grew two files in turn");
+
+  memset (buf, 'z', sizeof buf);
+  if (inode_write_at (inodes[0], buf, sizeof buf, GAP_END * DISK_SECTOR_SIZE)
+      != sizeof buf)
+    fail ("can't write past the gap");
+  check_gap (inodes[0]);
+  msg ("wrote past a gap");
+
+  for (f = 0; f < 2; f++) 
+    {
+      inode_close (inodes[f]);
+      inodes[f] = inode_open (sectors[f]);
+      if (inodes[f] == NULL)
+        fail ("can't reopen file %d", f);
+      check_sectors (inodes[f], f);
+    }
+  check_gap (inodes[0]);
+  msg ("read both files back from disk");
+
+  for (f = 0; f < 2; f++) 
+    {
+      inode_remove (inodes[f]);
+      inode_close (inodes[f]);
+    }
+  pass ();
+}
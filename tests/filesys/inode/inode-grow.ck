@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(inode-grow) begin
+(inode-grow) grew two files in turn
+(inode-grow) wrote past a gap
+(inode-grow) read both files back from disk
+(inode-grow) PASS
+(inode-grow) end
+EOF
+pass;
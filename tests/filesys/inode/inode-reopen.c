@@ -0,0 +1,55 @@
+/* Opens one inode several times and checks that every opener gets
+   the same in-memory inode, and that after the last one closes,
+   opening the sector again reads the inode from disk afresh instead
+   of finding the old one. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "filesys/inode.h"
+
+void
+test_inode_reopen (void) 
+{
+  static const char data[300];
+  disk_sector_t sector;
+  struct inode *a, *b, *c;
+
+  if (!inode_sector_allocate (&sector) || !inode_create (sector, 0))
+    fail ("can't create an inode");
+  a = inode_open (sector);
+  b = inode_open (sector);
+  if (a == NULL || b != a)
+    fail ("two opens gave two inodes");
+  c = inode_reopen (b);
+  if (c != a)
+    fail ("reopen gave another inode");
+  if (inode_write_at (a, data, sizeof data, 0) != sizeof data)
+    fail ("write failed");
+  if (inode_length (b) != sizeof data)
+    fail ("other opener sees length %d", inode_length (b));
+  msg ("openers share one inode");
+
+  /* Closing all but one keeps it. */
+  inode_close (a);
+  inode_close (b);
+  a = inode_open (sector);
+  if (a != c)
+    fail ("inode left the table while still open");
+  inode_close (a);
+  inode_close (c);
+
+  /* A new inode in the same sector must be read from disk.  The
+     old inode's data sector is leaked. */
+  if (!inode_create (sector, 0))
+    fail ("can't create an inode again");
+  a = inode_open (sector);
+  if (a == NULL)
+    fail ("can't open the new inode");
+  if (inode_length (a) != 0)
+    fail ("reopened inode has the old length %d", inode_length (a));
+  msg ("closed inode was read afresh");
+
+  inode_remove (a);
+  inode_close (a);
+  pass ();
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(inode-reopen) begin
+(inode-reopen) openers share one inode
+(inode-reopen) closed inode was read afresh
+(inode-reopen) PASS
+(inode-reopen) end
+EOF
+pass;
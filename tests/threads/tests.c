@@ -38,6 +38,19 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+#ifdef FILESYS
+    {"dir-grow", test_dir_grow},
+    {"dir-readdir-grow", test_dir_readdir_grow},
+    {"dir-flat", test_dir_flat},
+    {"inode-reopen", test_inode_reopen},
+    {"inode-grow", test_inode_grow},
+#endif
+#ifdef EFILESYS
+    {"fat-alloc", test_fat_alloc},
+    {"fat-chain", test_fat_chain},
+    {"fat-flush", test_fat_flush},
+    {"fat-cluster", test_fat_cluster},
+#endif
   };
 
 static const char *test_name;
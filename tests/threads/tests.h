@@ -32,6 +32,15 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_dir_grow;
+extern test_func test_dir_readdir_grow;
+extern test_func test_dir_flat;
+extern test_func test_inode_reopen;
+extern test_func test_inode_grow;
+extern test_func test_fat_alloc;
+extern test_func test_fat_chain;
+extern test_func test_fat_flush;
+extern test_func test_fat_cluster;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,37 @@
+/* Child process of launch-prefetch.
+   Reads every page of a large initialized array, in an order that
+   fault-around does not follow, and stores the number of faults it
+   took on pages read from its executable into the file named by
+   argv[1]. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-launch";
+
+#define PAGE_CNT 16
+
+/* Initialized, so every page of it is read from the executable. */
+char data[PAGE_CNT * 4096] = {1};
+
+int
+main (int argc, char *argv[])
+{
+  volatile char sum = 0;
+  long long faults;
+  int fd;
+  int i;
+
+  if (argc != 2)
+    fail ("usage: child-launch FILE");
+  for (i = 0; i < PAGE_CNT; i++)
+    sum += data[(i * 5 % PAGE_CNT) * 4096];
+  faults = get_fault_cnt (FAULT_LAZY_FILE);
+
+  if ((fd = open (argv[1])) < 2)
+    fail ("open \"%s\"", argv[1]);
+  if (write (fd, &faults, sizeof faults) != sizeof faults)
+    fail ("write \"%s\"", argv[1]);
+  close (fd);
+  return 0;
+}
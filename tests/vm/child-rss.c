@@ -0,0 +1,30 @@
+/* Child process of rss-limit.
+   Sets a small resident-set limit, then writes one byte to every page
+   of an array larger than memory, so that pages have to be evicted,
+   and checks that they all read back. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-rss";
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (12 * 1024 * 1024)
+#define PAGE_CNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char big_chunk[CHUNK_SIZE];
+
+int
+main (void)
+{
+  size_t i;
+
+  if (set_rss_limit (64) != 0)
+    fail ("set_rss_limit (64)");
+  for (i = 0; i < PAGE_CNT; i++)
+    big_chunk[i * PAGE_SIZE] = (char) i;
+  for (i = 0; i < PAGE_CNT; i++)
+    if (big_chunk[i * PAGE_SIZE] != (char) i)
+      fail ("data is inconsistent in page %zu", i);
+  return 0;
+}
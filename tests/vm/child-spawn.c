@@ -0,0 +1,28 @@
+/* Child process of spawn-fd.
+   Reads the sample through the descriptor in argv[1] and makes sure
+   the one in argv[2] was not inherited. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "child-spawn";
+
+int
+main (int argc, char *argv[])
+{
+  char buf[1024];
+
+  if (argc != 3)
+    fail ("usage: child-spawn FD FD");
+  if (read (atoi (argv[1]), buf, strlen (sample)) != (int) strlen (sample)
+      || memcmp (buf, sample, strlen (sample)))
+    fail ("inherited descriptor reads bad data");
+  if (read (atoi (argv[2]), buf, 1) != -1)
+    fail ("descriptor not in fd_map was inherited");
+
+  return 0x42;
+}
@@ -0,0 +1,104 @@
+/* Fills some pages with distinct contents and forks children that
+   keep them untouched while reading a file, which blocks often enough
+   for ksmd to run.  Each child waits until the merging counters show
+   at least one process's worth of pages saved, then checks its pages.
+   The parent then writes to its own pages, which must copy them back
+   out of the shared frames. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+#define PAGE_CNT 32
+#define CHILD_CNT 3
+#define BIG_SIZE (128 * 512)
+#define MAX_ROUNDS 1000
+
+static char pages[PAGE_CNT][PGSIZE] __attribute__ ((aligned (PGSIZE)));
+static char buf[PGSIZE];
+
+/* Checks that every page still holds VALUE plus its index. */
+static void
+check_pages (int value)
+{
+  int i, j;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    for (j = 0; j < PGSIZE; j++)
+      if (pages[i][j] != (char) (value + i))
+        fail ("byte %d of page %d is %d", j, i, pages[i][j]);
+}
+
+static void
+fill_pages (int value)
+{
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    memset (pages[i], value + i, PGSIZE);
+}
+
+/* Reads "big" until enough pages are merged.  Returns the pages saved
+   at the end. */
+static long long
+wait_for_merge (void)
+{
+  long long saved = 0;
+  int fd, round, i;
+
+  fd = open ("big");
+  if (fd < 2)
+    fail ("open \"big\" failed");
+  for (round = 0; round < MAX_ROUNDS; round++)
+    {
+      saved = get_ksm_cnt (KSM_PAGES_SAVED);
+      if (saved >= PAGE_CNT)
+        break;
+      seek (fd, 0);
+      for (i = 0; i < BIG_SIZE / PGSIZE; i++)
+        if (read (fd, buf, PGSIZE) != PGSIZE)
+          fail ("read \"big\" failed");
+    }
+  close (fd);
+  return saved;
+}
+
+void
+test_main (void)
+{
+  pid_t child[CHILD_CNT];
+  long long saved;
+  int i;
+
+  CHECK (create ("big", BIG_SIZE), "create \"big\"");
+  fill_pages (1);
+  msg ("filled %d pages", PAGE_CNT);
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      child[i] = fork ("ksm-fork");
+      if (child[i] == 0)
+        {
+          saved = wait_for_merge ();
+          if (saved < PAGE_CNT)
+            fail ("only %lld pages saved", saved);
+          if (get_ksm_cnt (KSM_PAGES_SHARED) <= 0)
+            fail ("pages saved but none shared");
+          check_pages (1);
+          exit (0);
+        }
+      else if (child[i] < 0)
+        fail ("fork failed");
+    }
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (child[i]) != 0)
+      fail ("child %d failed", i);
+  msg ("children saw merged pages");
+
+  check_pages (1);
+  fill_pages (2);
+  check_pages (2);
+  msg ("wrote merged pages");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ksm-fork) begin
+(ksm-fork) create "big"
+(ksm-fork) filled 32 pages
+ksm-fork: exit(0)
+ksm-fork: exit(0)
+ksm-fork: exit(0)
+(ksm-fork) children saw merged pages
+(ksm-fork) wrote merged pages
+(ksm-fork) end
+ksm-fork: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Runs child-launch twice and checks that the second launch, which
+   replays the trace the first one recorded, takes fewer faults on
+   pages of its executable. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Spawns child-launch and returns the file faults it reported. */
+static long long
+launch (void)
+{
+  long long faults;
+  pid_t child;
+  int fd;
+
+  CHECK ((child = spawn ("child-launch faults", NULL)) != -1,
+         "spawn \"child-launch\"");
+  CHECK (wait (child) == 0, "wait for child");
+  CHECK ((fd = open ("faults")) > 1, "open \"faults\"");
+  CHECK (read (fd, &faults, sizeof faults) == sizeof faults,
+         "read \"faults\"");
+  close (fd);
+  return faults;
+}
+
+void
+test_main (void)
+{
+  long long cold, warm;
+
+  CHECK (create ("faults", sizeof cold), "create \"faults\"");
+  cold = launch ();
+  warm = launch ();
+  if (warm >= cold)
+    fail ("warm launch took %lld file faults, cold launch %lld",
+          warm, cold);
+  msg ("warm launch took fewer file faults");
+}
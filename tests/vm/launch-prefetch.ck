@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(launch-prefetch) begin
+(launch-prefetch) create "faults"
+(launch-prefetch) spawn "child-launch"
+child-launch: exit(0)
+(launch-prefetch) wait for child
+(launch-prefetch) open "faults"
+(launch-prefetch) read "faults"
+(launch-prefetch) spawn "child-launch"
+child-launch: exit(0)
+(launch-prefetch) wait for child
+(launch-prefetch) open "faults"
+(launch-prefetch) read "faults"
+(launch-prefetch) warm launch took fewer file faults
+(launch-prefetch) end
+launch-prefetch: exit(0)
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Maps a file with MAP_POPULATE, then drops the page and loads it
+   again with madvise(), checking residency and contents each time.
+   Also checks that dropping a page of initialized data keeps it. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Writable, and read from the executable. */
+char data[] = "initialized data";
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  void *map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (actual, 4096, MAP_POPULATE, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\" with MAP_POPULATE");
+  CHECK (get_phys_addr (actual) != 0, "check if page is loaded");
+
+  CHECK (madvise (actual, 4096, MADV_DONTNEED) == 0, "madvise MADV_DONTNEED");
+  CHECK (get_phys_addr (actual) == 0, "check if page is not loaded");
+
+  CHECK (madvise (actual, 4096, MADV_WILLNEED) == 0, "madvise MADV_WILLNEED");
+  CHECK (get_phys_addr (actual) != 0, "check if page is loaded");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+
+  CHECK (madvise (actual, 4096, 99) == -1, "madvise with bad advice");
+  CHECK (madvise (actual + 1, 4096, MADV_NORMAL) == -1,
+         "madvise misaligned address");
+
+  CHECK (madvise ((void *) ((uintptr_t) data & ~(uintptr_t) 0xfff), 4096,
+                 MADV_DONTNEED) == 0,
+         "madvise MADV_DONTNEED on initialized data");
+  if (strcmp (data, "initialized data"))
+    fail ("initialized data was lost");
+
+  munmap (map);
+  close (handle);
+}
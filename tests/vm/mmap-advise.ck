@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-advise) begin
+(mmap-advise) open "sample.txt"
+(mmap-advise) mmap "sample.txt" with MAP_POPULATE
+(mmap-advise) check if page is loaded
+(mmap-advise) madvise MADV_DONTNEED
+(mmap-advise) check if page is not loaded
+(mmap-advise) madvise MADV_WILLNEED
+(mmap-advise) check if page is loaded
+(mmap-advise) madvise with bad advice
+(mmap-advise) madvise misaligned address
+(mmap-advise) madvise MADV_DONTNEED on initialized data
+(mmap-advise) end
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Reads one byte from every page of a 64-page mapped file, front to
+   back.  Sequential faults map the pages after them too, so the scan
+   must take far fewer faults than it has pages, and every page must
+   still hold what was written to the file. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+#define PAGE_CNT 64
+
+static char page[PGSIZE];
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  long long faults;
+  int handle;
+  void *map;
+  size_t i;
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      page[0] = i;
+      if (write (handle, page, PGSIZE) != PGSIZE)
+        fail ("write of page %zu failed", i);
+    }
+  CHECK ((map = mmap (actual, PAGE_CNT * PGSIZE, 0, handle, 0)) != MAP_FAILED,
+         "mmap \"data\"");
+
+  faults = get_fault_cnt (FAULT_LAZY_FILE);
+  for (i = 0; i < PAGE_CNT; i++)
+    if (actual[i * PGSIZE] != (char) i)
+      fail ("page %zu of mmap'd region has %d (should be %zu)",
+            i, actual[i * PGSIZE], i);
+  faults = get_fault_cnt (FAULT_LAZY_FILE) - faults;
+
+  if (faults * 4 > PAGE_CNT)
+    fail ("scan of %d pages took %lld faults", PAGE_CNT, faults);
+  msg ("scan took far fewer faults than pages");
+
+  munmap (map);
+  close (handle);
+}
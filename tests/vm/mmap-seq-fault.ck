@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mmap-seq-fault) begin
+(mmap-seq-fault) create "data"
+(mmap-seq-fault) open "data"
+(mmap-seq-fault) mmap "data"
+(mmap-seq-fault) scan took far fewer faults than pages
+(mmap-seq-fault) end
+mmap-seq-fault: exit(0)
+EOF
+pass;
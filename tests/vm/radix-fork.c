@@ -0,0 +1,98 @@
+/* Maps a file at addresses that fall under different entries of
+   every level of the supplemental page table, touches only some of
+   the mappings, fills a few anonymous pages, and forks.  The child
+   must find every page, touched or still lazy, with the right
+   contents, and its writes to the anonymous pages must not reach the
+   parent. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+#define MAP_CNT 4
+#define ANON_CNT 3
+
+/* Each differs from the one before in a higher-level index. */
+static char *const maps[MAP_CNT] = {
+  (char *) 0x10000000,          /* Last-level table of its own. */
+  (char *) 0x10201000,          /* Next page directory entry. */
+  (char *) 0x150000000,         /* Another page directory pointer entry. */
+  (char *) 0x7000000000,        /* Far up the same pml4 entry. */
+};
+
+static char anon[ANON_CNT][PGSIZE] __attribute__ ((aligned (PGSIZE)));
+
+/* Checks that every anonymous page still holds VALUE plus its index. */
+static void
+check_anon (int value)
+{
+  int i, j;
+
+  for (i = 0; i < ANON_CNT; i++)
+    for (j = 0; j < PGSIZE; j++)
+      if (anon[i][j] != (char) (value + i))
+        fail ("byte %d of anonymous page %d is %d", j, i, anon[i][j]);
+}
+
+static void
+fill_anon (int value)
+{
+  int i;
+
+  for (i = 0; i < ANON_CNT; i++)
+    memset (anon[i], value + i, PGSIZE);
+}
+
+/* Checks that every mapping holds the file. */
+static void
+check_maps (void)
+{
+  int i;
+
+  for (i = 0; i < MAP_CNT; i++)
+    if (memcmp (maps[i], sample, strlen (sample)))
+      fail ("mapping at %p has bad data", maps[i]);
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+  int i;
+
+  for (i = 0; i < MAP_CNT; i++)
+    {
+      int fd = open ("sample.txt");
+      if (fd < 2)
+        fail ("open \"sample.txt\" failed");
+      if (mmap (maps[i], PGSIZE, 0, fd, 0) != maps[i])
+        fail ("mmap at %p failed", maps[i]);
+    }
+  if (memcmp (maps[0], sample, strlen (sample))
+      || memcmp (maps[1], sample, strlen (sample)))
+    fail ("mapped file has bad data");
+  fill_anon (1);
+  msg ("mapped %d pages and filled %d", MAP_CNT, ANON_CNT);
+
+  child = fork ("radix-fork");
+  if (child == 0)
+    {
+      check_maps ();
+      check_anon (1);
+      fill_anon (2);
+      check_anon (2);
+      exit (0);
+    }
+  else if (child < 0)
+    fail ("fork failed");
+  if (wait (child) != 0)
+    fail ("child failed");
+  msg ("child found every page");
+
+  check_maps ();
+  check_anon (1);
+  msg ("parent's pages are unchanged");
+}
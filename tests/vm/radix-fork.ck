@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(radix-fork) begin
+(radix-fork) mapped 4 pages and filled 3
+radix-fork: exit(0)
+(radix-fork) child found every page
+(radix-fork) parent's pages are unchanged
+(radix-fork) end
+radix-fork: exit(0)
+EOF
+pass;
@@ -0,0 +1,123 @@
+/* Runs this program again, and has both processes read a few pages
+   of read-only data, which the text cache backs with one frame
+   each.  The first process then writes enough memory to push them
+   out.  Evicting a shared frame must unmap it from every process
+   that maps it, so each page the first process lost must be gone
+   from the second one too, and both must read the pages back
+   afterwards.  The file "rmap-child" tells the second process apart;
+   "ready" and "evicted" pass the turn between the two. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+#define RO_CNT 8
+
+/* More than the user pool holds. */
+#define PRESSURE_CNT 2048
+
+static const char ro[RO_CNT][PGSIZE] __attribute__ ((aligned (PGSIZE)))
+  = {{'a'}, {'b'}, {'c'}, {'d'}, {'e'}, {'f'}, {'g'}, {'h'}};
+
+static char pressure[PRESSURE_CNT][PGSIZE];
+
+/* Checks every read-only page. */
+static void
+check_ro (void)
+{
+  int i;
+
+  for (i = 0; i < RO_CNT; i++)
+    if (ro[i][0] != 'a' + i || ro[i][1] != 0)
+      fail ("read-only page %d has bad data", i);
+}
+
+/* Waits until file NAME is SIZE bytes long and returns it open. */
+static int
+wait_for (const char *name, int size)
+{
+  for (;;)
+    {
+      int fd = open (name);
+      if (fd > 1)
+        {
+          if (filesize (fd) == size)
+            return fd;
+          close (fd);
+        }
+    }
+}
+
+static void
+run_child (void)
+{
+  unsigned mask;
+  int fd, i;
+
+  check_ro ();
+  if (!create ("ready", 0))
+    fail ("create \"ready\" failed");
+
+  fd = wait_for ("evicted", sizeof mask);
+  if (read (fd, &mask, sizeof mask) != sizeof mask)
+    fail ("read \"evicted\" failed");
+  close (fd);
+  for (i = 0; i < RO_CNT; i++)
+    if ((mask & (1u << i)) && get_phys_addr ((void *) ro[i]) != NULL)
+      fail ("page %d is still mapped in the child", i);
+  msg ("child lost the same pages");
+  check_ro ();
+  msg ("child read them back");
+}
+
+void
+test_main (void)
+{
+  unsigned mask = 0;
+  pid_t child;
+  int fd, i;
+
+  fd = open ("rmap-child");
+  if (fd > 1)
+    {
+      close (fd);
+      run_child ();
+      return;
+    }
+
+  CHECK (create ("rmap-child", 0), "create \"rmap-child\"");
+  check_ro ();
+  child = fork ("rmap-text");
+  if (child == 0)
+    {
+      exec ("rmap-text");
+      fail ("exec \"rmap-text\" failed");
+    }
+  else if (child < 0)
+    fail ("fork failed");
+  close (wait_for ("ready", 0));
+
+  for (i = 0; i < PRESSURE_CNT; i++)
+    memset (pressure[i], i, PGSIZE);
+  for (i = 0; i < RO_CNT; i++)
+    if (get_phys_addr ((void *) ro[i]) == NULL)
+      mask |= 1u << i;
+  if (mask == 0)
+    fail ("no read-only page was evicted");
+  msg ("evicted shared pages");
+
+  /* The file only reaches its full size once the write is done. */
+  if (!create ("evicted", 0))
+    fail ("create \"evicted\" failed");
+  fd = open ("evicted");
+  if (fd < 2 || write (fd, &mask, sizeof mask) != sizeof mask)
+    fail ("write \"evicted\" failed");
+  close (fd);
+
+  if (wait (child) != 0)
+    fail ("child failed");
+  check_ro ();
+  msg ("parent read them back");
+}
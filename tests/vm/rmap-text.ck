@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rmap-text) begin
+(rmap-text) create "rmap-child"
+(rmap-text) begin
+(rmap-text) evicted shared pages
+(rmap-text) child lost the same pages
+(rmap-text) child read them back
+(rmap-text) end
+rmap-text: exit(0)
+(rmap-text) parent read them back
+(rmap-text) end
+rmap-text: exit(0)
+EOF
+pass;
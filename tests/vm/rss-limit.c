@@ -0,0 +1,53 @@
+/* Sets a resident-set limit and checks that get_rss() reports it,
+   along with the frames the process holds after touching pages and
+   the working set a sampling pass sees while it keeps touching them.
+   Then runs child-rss, which goes far over a limit of its own while
+   writing more than fits in memory, and checks that the evictions
+   this forces all come from the child: this process, which has no
+   limit, keeps every frame it held. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 16
+
+static char buf[PAGE_CNT * 4096];
+
+void
+test_main (void)
+{
+  volatile char sum = 0;
+  long long before, wss;
+  pid_t child;
+  size_t i;
+
+  CHECK (get_rss (RSS_LIMIT) == 0, "no limit at start");
+  CHECK (set_rss_limit (32) == 0, "set_rss_limit (32)");
+  CHECK (get_rss (RSS_LIMIT) == 32, "limit reads back");
+
+  before = get_rss (RSS_RESIDENT);
+  /* Different contents, so no two pages get merged. */
+  for (i = 0; i < PAGE_CNT; i++)
+    memset (buf + i * 4096, i + 1, 4096);
+  CHECK (get_rss (RSS_RESIDENT) >= before + PAGE_CNT,
+         "touched pages are resident");
+
+  /* Keep the pages hot until a whole sampling pass has seen them. */
+  while ((wss = get_rss (RSS_WORKING_SET)) < PAGE_CNT)
+    for (i = 0; i < PAGE_CNT; i++)
+      sum += buf[i * 4096];
+  CHECK (wss <= get_rss (RSS_RESIDENT),
+         "working set covers the touched pages");
+  CHECK (get_rss (-1) == -1, "unknown query fails");
+
+  CHECK (set_rss_limit (0) == 0, "set_rss_limit (0)");
+  before = get_rss (RSS_RESIDENT);
+  CHECK ((child = spawn ("child-rss", NULL)) != -1, "spawn \"child-rss\"");
+  CHECK (wait (child) == 0, "wait for child");
+  if (get_rss (RSS_RESIDENT) < before)
+    fail ("%lld of %lld frames evicted from the process under its limit",
+          before - get_rss (RSS_RESIDENT), before);
+  msg ("evictions came from the process over its limit");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rss-limit) begin
+(rss-limit) no limit at start
+(rss-limit) set_rss_limit (32)
+(rss-limit) limit reads back
+(rss-limit) touched pages are resident
+(rss-limit) working set covers the touched pages
+(rss-limit) unknown query fails
+(rss-limit) set_rss_limit (0)
+(rss-limit) spawn "child-rss"
+child-rss: exit(0)
+(rss-limit) wait for child
+(rss-limit) evictions came from the process over its limit
+(rss-limit) end
+rss-limit: exit(0)
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Spawns child-spawn with one of two open descriptors and checks
+   that only that one is inherited, at its own file position. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int shared, private;
+  int fd_map[2];
+  char cmd_line[64];
+  char buf[1024];
+  pid_t child;
+
+  CHECK ((shared = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((private = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+
+  fd_map[0] = shared;
+  fd_map[1] = -1;
+  snprintf (cmd_line, sizeof cmd_line, "child-spawn %d %d", shared, private);
+  CHECK ((child = spawn (cmd_line, fd_map)) != -1, "spawn \"child-spawn\"");
+  CHECK (wait (child) == 0x42, "wait for child");
+
+  CHECK (read (shared, buf, strlen (sample)) == (int) strlen (sample),
+         "read \"sample.txt\"");
+  CHECK (!memcmp (buf, sample, strlen (sample)),
+         "compare read data against sample");
+
+  fd_map[0] = private;
+  fd_map[1] = private + 1;
+  CHECK (spawn ("child-spawn", fd_map) == -1, "spawn with a closed fd");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-fd) begin
+(spawn-fd) open "sample.txt"
+(spawn-fd) open "sample.txt" again
+(spawn-fd) spawn "child-spawn"
+child-spawn: exit(66)
+(spawn-fd) wait for child
+(spawn-fd) read "sample.txt"
+(spawn-fd) compare read data against sample
+(spawn-fd) spawn with a closed fd
+(spawn-fd) end
+spawn-fd: exit(0)
+EOF
+pass;
@@ -0,0 +1,72 @@
+/* Runs this program again while it is still running.  The second
+   process must map the frame the first one faulted in for a page of
+   code, but get a frame of its own for a page of writable data.
+   The file "text-pa" tells the second process apart and passes it
+   the first one's physical addresses. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+
+/* Initialized, so it is loaded from the file like the code. */
+static int data[PGSIZE / sizeof (int)] __attribute__ ((aligned (PGSIZE)))
+  = {1};
+
+/* Checks that the code and data of this process map the frames
+   recorded in FD by the first process, or not. */
+static void
+check_child (int fd)
+{
+  void *pa[2];
+
+  if (read (fd, pa, sizeof pa) != sizeof pa)
+    fail ("read \"text-pa\" failed");
+  close (fd);
+  if (get_phys_addr ((void *) test_main) != pa[0])
+    fail ("code maps a frame of its own");
+  msg ("child maps the parent's code frame");
+  if (data[0] != 1)
+    fail ("data is %d, not 1", data[0]);
+  if (get_phys_addr (data) == pa[1])
+    fail ("data maps the parent's frame");
+  msg ("child has its own data frame");
+}
+
+void
+test_main (void)
+{
+  void *pa[2];
+  pid_t child;
+  int fd;
+
+  fd = open ("text-pa");
+  if (fd > 1)
+    {
+      check_child (fd);
+      return;
+    }
+
+  if (data[0] != 1)
+    fail ("data is %d, not 1", data[0]);
+  pa[0] = get_phys_addr ((void *) test_main);
+  pa[1] = get_phys_addr (data);
+  CHECK (create ("text-pa", sizeof pa), "create \"text-pa\"");
+  fd = open ("text-pa");
+  if (fd < 2 || write (fd, pa, sizeof pa) != sizeof pa)
+    fail ("write \"text-pa\" failed");
+  close (fd);
+
+  child = fork ("text-share");
+  if (child == 0)
+    {
+      exec ("text-share");
+      fail ("exec \"text-share\" failed");
+    }
+  else if (child < 0)
+    fail ("fork failed");
+  if (wait (child) != 0)
+    fail ("child failed");
+  msg ("child ran");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(text-share) begin
+(text-share) create "text-pa"
+(text-share) begin
+(text-share) child maps the parent's code frame
+(text-share) child has its own data frame
+(text-share) end
+text-share: exit(0)
+(text-share) child ran
+(text-share) end
+text-share: exit(0)
+EOF
+pass;
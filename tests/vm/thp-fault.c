@@ -0,0 +1,74 @@
+/* Writes one byte to every page of two 2 MB-aligned regions of a
+   large BSS array.  The first region was never touched, so its first
+   write fault maps all of it with one 2 MB page.  The second is read
+   first, which maps the zero page and keeps it from qualifying, so
+   every write takes a fault of its own.  Checks that the first sweep
+   takes far fewer faults and less time. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+#define HPGSIZE (2 * 1024 * 1024)
+
+static char buf[3 * HPGSIZE];
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Returns the faults that can back an anonymous page so far. */
+static long long
+anon_faults (void)
+{
+  return get_fault_cnt (FAULT_LAZY_ANON) + get_fault_cnt (FAULT_COW);
+}
+
+/* Writes every page of the 2 MB REGION.  Returns the faults it took
+   and stores the cycles in *CYCLES. */
+static long long
+sweep (char *region, uint64_t *cycles)
+{
+  long long faults = anon_faults ();
+  uint64_t start = rdtsc ();
+  size_t i;
+
+  for (i = 0; i < HPGSIZE; i += PGSIZE)
+    region[i] = 1;
+  *cycles = rdtsc () - start;
+  return anon_faults () - faults;
+}
+
+void
+test_main (void)
+{
+  char *huge = (char *) (((uintptr_t) buf + HPGSIZE - 1)
+                         & ~(uintptr_t) (HPGSIZE - 1));
+  char *small = huge + HPGSIZE;
+  volatile char sum = 0;
+  long long huge_faults, small_faults;
+  uint64_t huge_cycles, small_cycles;
+  size_t i;
+
+  for (i = 0; i < HPGSIZE; i += PGSIZE)
+    sum += small[i];
+
+  huge_faults = sweep (huge, &huge_cycles);
+  small_faults = sweep (small, &small_cycles);
+
+  if (huge_faults * 64 > small_faults)
+    fail ("2 MB region took %lld faults, 4 kB region %lld",
+          huge_faults, small_faults);
+  msg ("2 MB region took far fewer faults");
+  if (huge_cycles >= small_cycles)
+    fail ("2 MB region took %llu cycles, 4 kB region %llu",
+          (unsigned long long) huge_cycles,
+          (unsigned long long) small_cycles);
+  msg ("2 MB region took less time");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thp-fault) begin
+(thp-fault) 2 MB region took far fewer faults
+(thp-fault) 2 MB region took less time
+(thp-fault) end
+thp-fault: exit(0)
+EOF
+pass;
@@ -0,0 +1,85 @@
+/* Reads untouched anonymous pages, which must all map one shared
+   frame of zeros, then writes to some of them, in the parent and
+   in a forked child, each of which must get a frame of its own
+   while the pages left alone keep sharing the zero frame. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+#define PAGE_CNT 4
+
+static char buf[PAGE_CNT][PGSIZE] __attribute__ ((aligned (PGSIZE)));
+
+/* Checks that page I of BUF holds only VALUE. */
+static void
+check_page (int i, char value)
+{
+  int j;
+
+  for (j = 0; j < PGSIZE; j++)
+    if (buf[i][j] != value)
+      fail ("byte %d of page %d is %d, not %d", j, i, buf[i][j], value);
+}
+
+void
+test_main (void)
+{
+  void *zero;
+  pid_t child;
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    check_page (i, 0);
+  zero = get_phys_addr (buf[0]);
+  if (zero == NULL)
+    fail ("read did not map page 0");
+  for (i = 1; i < PAGE_CNT; i++)
+    if (get_phys_addr (buf[i]) != zero)
+      fail ("page %d does not share the zero frame", i);
+  msg ("read pages share one frame");
+
+  memset (buf[1], 'p', PGSIZE);
+  if (get_phys_addr (buf[1]) == zero)
+    fail ("written page still maps the zero frame");
+  check_page (1, 'p');
+  for (i = 0; i < PAGE_CNT; i++)
+    if (i != 1)
+      {
+        if (get_phys_addr (buf[i]) != zero)
+          fail ("page %d lost the zero frame", i);
+        check_page (i, 0);
+      }
+  msg ("written page got its own frame");
+
+  child = fork ("zero-cow");
+  if (child == 0)
+    {
+      /* The child's untouched pages start over lazily. */
+      check_page (2, 0);
+      if (get_phys_addr (buf[2]) != zero)
+        fail ("child's page 2 does not share the zero frame");
+      memset (buf[2], 'c', PGSIZE);
+      if (get_phys_addr (buf[2]) == zero)
+        fail ("child's written page still maps the zero frame");
+      check_page (1, 'p');
+      check_page (2, 'c');
+      check_page (3, 0);
+      exit (0);
+    }
+  else if (child < 0)
+    fail ("fork failed");
+  if (wait (child) != 0)
+    fail ("child failed");
+  msg ("child wrote its own copy");
+
+  check_page (0, 0);
+  check_page (1, 'p');
+  check_page (2, 0);
+  check_page (3, 0);
+  if (get_phys_addr (buf[2]) != zero)
+    fail ("child's write took page 2 off the zero frame");
+  msg ("parent's pages are unchanged");
+}
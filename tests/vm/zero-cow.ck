@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(zero-cow) begin
+(zero-cow) read pages share one frame
+(zero-cow) written page got its own frame
+zero-cow: exit(0)
+(zero-cow) child wrote its own copy
+(zero-cow) parent's pages are unchanged
+(zero-cow) end
+zero-cow: exit(0)
+EOF
+pass;
@@ -31,9 +31,13 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/ksm.h"
+#include "vm/kswapd.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
+#include "filesys/buffer-cache.h"
+#include "filesys/directory.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -226,6 +230,14 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-ksm"))
+			ksm_pages_to_scan = atoi (value);
+		else if (!strcmp (name, "-kswapd-low"))
+			kswapd_low_wmark = atoi (value);
+		else if (!strcmp (name, "-kswapd-high"))
+			kswapd_high_wmark = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -328,6 +340,15 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -ksm=PAGES         Merge identical pages, scanning PAGES per\n"
+			"                     wakeup (default 100, 0 disables).\n"
+			"  -kswapd-low=PAGES  Start background reclaim below PAGES free\n"
+			"                     user frames (default 1/64 of the pool,\n"
+			"                     0 disables).\n"
+			"  -kswapd-high=PAGES Reclaim until PAGES frames are free\n"
+			"                     (default twice the low watermark).\n"
 #endif
 			);
 	power_off ();
@@ -356,10 +377,15 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	buffer_cache_print_stats ();
+	dir_print_stats ();
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
 }
@@ -2,12 +2,56 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Page tables set aside for splitting 2 MB pages, one for every 2 MB
+ * page mapped, so that a split never runs out of memory.  They are
+ * linked through their first word. */
+static void *split_reserve;
+
+/* Adds PT, an unused page table, to the split reserve. */
+static void
+split_reserve_push(void *pt)
+{
+	enum intr_level old_level = intr_disable();
+	*(void **)pt = split_reserve;
+	split_reserve = pt;
+	intr_set_level(old_level);
+}
+
+/* Takes a page table out of the split reserve, which must hold one
+ * for each 2 MB page still mapped. */
+static void *
+split_reserve_pop(void)
+{
+	enum intr_level old_level = intr_disable();
+	void *pt = split_reserve;
+	ASSERT(pt != NULL);
+	split_reserve = *(void **)pt;
+	intr_set_level(old_level);
+	return pt;
+}
+
+/* Replaces the 2 MB mapping in *PDE by a page table that maps the
+ * same frames 4 kB at a time with the same permission, accessed and
+ * dirty bits.  The page table comes from the split reserve. */
+static void
+pde_split(uint64_t *pde)
+{
+	uint64_t *pt = split_reserve_pop();
+
+	uint64_t pa = PTE_ADDR(*pde);
+	uint64_t flags = *pde & PTE_FLAGS & ~PTE_PS;
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t); i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+	*pde = vtop(pt) | PTE_U | PTE_W | PTE_P;
+}
+
 static uint64_t *
 pgdir_walk(uint64_t *pdp, const uint64_t va, int create)
 {
@@ -28,6 +72,14 @@ pgdir_walk(uint64_t *pdp, const uint64_t va, int create)
 			else
 				return NULL;
 		}
+		else if (pdp[idx] & PTE_PS)
+		{
+			/* A 2 MB page: its entry stands for every 4 kB page in
+			 * it, unless the caller means to change one of them. */
+			if (!create)
+				return &pdp[idx];
+			pde_split(&pdp[idx]);
+		}
 		return (uint64_t *)ptov(PTE_ADDR(pdp[idx]) + 8 * PTX(va));
 	}
 	return NULL;
@@ -149,7 +201,8 @@ pgdir_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux,
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
 		uint64_t *pte = ptov((uint64_t *)pdp[i]);
-		if (((uint64_t)pte) & PTE_P)
+		/* 2 MB pages have no page table to visit. */
+		if ((((uint64_t)pte) & PTE_P) && !(pdp[i] & PTE_PS))
 			if (!pt_for_each((uint64_t *)PTE_ADDR(pte), func, aux,
 							 pml4_index, pdp_index, i))
 				return false;
@@ -205,7 +258,11 @@ pgdir_destroy(uint64_t *pdp)
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
 		uint64_t *pte = ptov((uint64_t *)pdp[i]);
-		if (((uint64_t)pte) & PTE_P)
+		/* The frames of a 2 MB page belong to the VM's frame table;
+		 * only its reserved page table is freed here. */
+		if ((((uint64_t)pte) & PTE_P) && (pdp[i] & PTE_PS))
+			palloc_free_page(split_reserve_pop());
+		else if (((uint64_t)pte) & PTE_P)
 			pt_destroy(PTE_ADDR(pte));
 	}
 	palloc_free_page((void *)pdp);
@@ -255,11 +312,68 @@ pml4_get_page(uint64_t *pml4, const void *uaddr)
 
 	uint64_t *pte = pml4e_walk(pml4, (uint64_t)uaddr, 0);
 
+	if (pte && (*pte & PTE_P) && (*pte & PTE_PS))
+		return ptov(PTE_ADDR(*pte)) + ((uint64_t)uaddr & (HPGSIZE - 1));
 	if (pte && (*pte & PTE_P))
 		return ptov(PTE_ADDR(*pte)) + pg_ofs(uaddr);
 	return NULL;
 }
 
+/* Maps the 2 MB-aligned user region at UPAGE to the physically
+ * contiguous, 2 MB-aligned frames at KPAGE with a single page
+ * directory entry.  No 4 kB page of the region may be mapped.  A page
+ * table for splitting the mapping later is set aside now: an empty
+ * one left there, or a new one.  Returns false if a page is mapped or
+ * memory allocation failed. */
+bool pml4_set_huge_page(uint64_t *pml4, void *upage, void *kpage, bool rw)
+{
+	ASSERT(((uint64_t)upage & (HPGSIZE - 1)) == 0);
+	ASSERT((vtop(kpage) & (HPGSIZE - 1)) == 0);
+	ASSERT(is_user_vaddr(upage));
+	ASSERT(pml4 != base_pml4);
+
+	uint64_t *table = pml4;
+	const unsigned idx[2] = {PML4(upage), PDPE(upage)};
+	for (int level = 0; level < 2; level++)
+	{
+		uint64_t *e = &table[idx[level]];
+		if (!(*e & PTE_P))
+		{
+			uint64_t *new_page = palloc_get_page(PAL_ZERO);
+			if (new_page == NULL)
+				return false;
+			*e = vtop(new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov(PTE_ADDR(*e));
+	}
+
+	uint64_t *pde = &table[PDX(upage)];
+	uint64_t *pt;
+	if (*pde & PTE_P)
+	{
+		if (*pde & PTE_PS)
+			return false;
+		pt = ptov(PTE_ADDR(*pde));
+		for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t); i++)
+			if (pt[i] & PTE_P)
+				return false;
+	}
+	else if ((pt = palloc_get_page(0)) == NULL)
+		return false;
+	split_reserve_push(pt);
+	*pde = vtop(kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	if (rcr3() == vtop(pml4))
+		invlpg((uint64_t)upage);
+	return true;
+}
+
+/* Returns true if UPAGE is mapped by a 2 MB page in PML4. */
+bool pml4_is_huge(uint64_t *pml4, const void *upage)
+{
+	uint64_t *pte = pml4e_walk(pml4, (uint64_t)upage, false);
+	return pte != NULL && (*pte & PTE_P) && (*pte & PTE_PS);
+}
+
 /* Adds a mapping in page map level 4 PML4 from user virtual page
  * UPAGE to the physical frame identified by kernel virtual address KPAGE.
  * UPAGE must not already be mapped. KPAGE should probably be a page obtained
@@ -294,6 +408,11 @@ void pml4_clear_page(uint64_t *pml4, void *upage)
 
 	pte = pml4e_walk(pml4, (uint64_t)upage, false);
 
+	/* Unmapping part of a 2 MB page splits it first, with the page table
+	 * reserved for that, so it cannot fail. */
+	if (pte != NULL && (*pte & PTE_P) && (*pte & PTE_PS))
+		pte = pml4e_walk(pml4, (uint64_t)upage, true);
+
 	if (pte != NULL && (*pte & PTE_P) != 0)
 	{
 		*pte &= ~PTE_P;
@@ -302,6 +421,33 @@ void pml4_clear_page(uint64_t *pml4, void *upage)
 	}
 }
 
+/* Sets the writable bit of the PTE for user virtual page UPAGE in
+ * PML4 to WRITABLE, keeping the accessed and dirty bits.  UPAGE need
+ * not be mapped. */
+void pml4_set_writable(uint64_t *pml4, void *upage, bool writable)
+{
+	uint64_t *pte;
+	ASSERT(pg_ofs(upage) == 0);
+	ASSERT(is_user_vaddr(upage));
+
+	pte = pml4e_walk(pml4, (uint64_t)upage, false);
+
+	/* Changing part of a 2 MB page splits it first, with the page table
+	 * reserved for that, so it cannot fail. */
+	if (pte != NULL && (*pte & PTE_P) && (*pte & PTE_PS))
+		pte = pml4e_walk(pml4, (uint64_t)upage, true);
+
+	if (pte != NULL && (*pte & PTE_P) != 0)
+	{
+		if (writable)
+			*pte |= PTE_W;
+		else
+			*pte &= ~PTE_W;
+		if (rcr3() == vtop(pml4))
+			invlpg((uint64_t)upage);
+	}
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
  * that is, if the page has been modified since the PTE was
  * installed.
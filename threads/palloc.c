@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -31,6 +32,7 @@ struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t free_cnt;                /* Free pages, see pool_count(). */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +44,7 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void pool_count (struct pool *, long delta);
 
 /* multiboot info */
 struct multiboot_info {
@@ -232,6 +235,11 @@ split:
 			}
 		}
 	}
+
+	kernel_pool.free_cnt = bitmap_count (kernel_pool.used_map, 0,
+			bitmap_size (kernel_pool.used_map), false);
+	user_pool.free_cnt = bitmap_count (user_pool.used_map, 0,
+			bitmap_size (user_pool.used_map), false);
 }
 
 /* Initializes the page allocator and get the memory size */
@@ -268,9 +276,10 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	lock_release (&pool->lock);
 	void *pages;
 
-	if (page_idx != BITMAP_ERROR)
+	if (page_idx != BITMAP_ERROR) {
 		pages = pool->base + PGSIZE * page_idx;
-	else
+		pool_count (pool, -(long) page_cnt);
+	} else
 		pages = NULL;
 
 	if (pages) {
@@ -284,6 +293,39 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	return pages;
 }
 
+/* Like palloc_get_multiple(), but the first page's address is a
+   multiple of ALIGN_CNT pages, e.g. 512 for a run that can be
+   mapped as one 2 MB page.  Kernel virtual and physical addresses
+   differ by a 2 MB-aligned offset, so both are aligned. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt,
+		size_t align_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t pool_cnt = bitmap_size (pool->used_map);
+	size_t first = (align_cnt - pg_no (pool->base) % align_cnt) % align_cnt;
+	size_t page_idx = BITMAP_ERROR;
+	void *pages = NULL;
+
+	lock_acquire (&pool->lock);
+	for (size_t i = first; i + page_cnt <= pool_cnt; i += align_cnt)
+		if (bitmap_none (pool->used_map, i, page_cnt)) {
+			bitmap_set_multiple (pool->used_map, i, page_cnt, true);
+			page_idx = i;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (page_idx != BITMAP_ERROR) {
+		pages = pool->base + PGSIZE * page_idx;
+		pool_count (pool, -(long) page_cnt);
+		if (flags & PAL_ZERO)
+			memset (pages, 0, PGSIZE * page_cnt);
+	} else if (flags & PAL_ASSERT)
+		PANIC ("palloc_get: out of pages");
+
+	return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -320,6 +362,7 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #endif
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool_count (pool, page_cnt);
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +371,18 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of free pages in the user pool. */
+size_t
+palloc_user_free_cnt (void) {
+	return user_pool.free_cnt;
+}
+
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -347,6 +402,16 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 	*bm_base += bm_pages;
 }
 
+/* Adds DELTA to POOL's free page count.  Pages are freed without
+   the pool lock, sometimes with interrupts off from the scheduler,
+   so the count is guarded by disabling interrupts instead. */
+static void
+pool_count (struct pool *pool, long delta) {
+	enum intr_level old_level = intr_disable ();
+	pool->free_cnt += delta;
+	intr_set_level (old_level);
+}
+
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
@@ -206,6 +206,10 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 
 	// 현재 스레드의 자식으로 추가
 	list_push_back(&thread_current()->child_list, &t->child_elem);
+#ifdef VM
+	// 메모리 한도는 fork와 spawn으로 만든 자식에게도 이어진다.
+	t->rss_limit = thread_current()->rss_limit;
+#endif
 
 	t->fdt = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
 	if (t->fdt == NULL)
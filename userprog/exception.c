@@ -64,6 +64,9 @@ void exception_init(void)
 void exception_print_stats(void)
 {
 	printf("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+	fault_stat_print();
+#endif
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -142,15 +145,15 @@ page_fault(struct intr_frame *f)
 	write = (f->error_code & PF_W) != 0;
 	user = (f->error_code & PF_U) != 0;
 
+	/* Count page faults, including the ones the VM resolves. */
+	page_fault_cnt++;
+
 #ifdef VM
 	/* For project 3 and later. */
 	if (vm_try_handle_fault(f, fault_addr, user, write, not_present))
 		return;
 #endif
 
-	/* Count page faults. */
-	page_fault_cnt++;
-
 	/* If the fault is true fault, show info and exit. */
 	printf("Page fault at %p: %s error %s page in %s context.\n",
 		   fault_addr,
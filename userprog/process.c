@@ -13,6 +13,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -20,12 +21,14 @@
 #include "intrinsic.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/launch.h"
 #endif
 
 static void process_cleanup(void);
 static bool load(const char *file_name, struct intr_frame *if_);
 static void initd(void *f_name);
 static void __do_fork(void *);
+static void spawn_child(void *);
 
 /* General process initializer for initd and other process. */
 static void
@@ -182,6 +185,9 @@ __do_fork(void *aux)
 
 	process_activate(current);
 #ifdef VM
+	/* 지연 로딩될 ELF 페이지가 읽을 실행 파일을 자식도 따로 연다. */
+	if (parent->running != NULL && (current->running = file_duplicate(parent->running)) == NULL)
+		goto error;
 	supplemental_page_table_init(&current->spt);
 	if (!supplemental_page_table_copy(&current->spt, &parent->spt))
 		goto error;
@@ -220,6 +226,93 @@ error:
 	exit(TID_ERROR);
 }
 
+/* What a spawned child starts with, handed over by process_spawn(). */
+struct spawn_aux
+{
+	char *cmd_line;						 /* Page with the command line. */
+	int fd_cnt;							 /* Number of inherited descriptors. */
+	int fds[FDT_COUNT_LIMIT];			 /* Their numbers, kept in the child. */
+	struct file *files[FDT_COUNT_LIMIT]; /* Their files, already duplicated. */
+};
+
+/* Starts CMD_LINE, a page that is handed over to the child, in a new
+ * process.  The child gets duplicates of the FD_CNT descriptors in
+ * FDS under the same numbers and no other open files.  Nothing of the
+ * current address space is copied and the caller does not wait for the
+ * load: a child that fails to load exits with -1, which wait() reports.
+ * Returns the new process's thread id, or TID_ERROR if a descriptor is
+ * not open or named twice or if the thread cannot be created. */
+tid_t process_spawn(char *cmd_line, const int *fds, int fd_cnt)
+{
+	struct spawn_aux *aux = malloc(sizeof *aux);
+	char name[sizeof thread_current()->name];
+	tid_t tid = TID_ERROR;
+	int i;
+
+	if (aux == NULL)
+		goto done;
+	aux->cmd_line = cmd_line;
+	for (aux->fd_cnt = 0; aux->fd_cnt < fd_cnt; aux->fd_cnt++)
+	{
+		int fd = fds[aux->fd_cnt];
+		struct file *file = process_get_file(fd);
+
+		for (i = 0; i < aux->fd_cnt; i++)
+			if (aux->fds[i] == fd)
+				file = NULL;
+		if (file == NULL || (file = file_duplicate(file)) == NULL)
+			goto done;
+		aux->fds[aux->fd_cnt] = fd;
+		aux->files[aux->fd_cnt] = file;
+	}
+
+	// 자식 스레드의 이름은 명령줄의 첫 단어이다.
+	strlcpy(name, cmd_line, sizeof name);
+	name[strcspn(name, " ")] = '\0';
+	tid = thread_create(name, PRI_DEFAULT, spawn_child, aux);
+
+done:
+	if (tid == TID_ERROR)
+	{
+		if (aux != NULL)
+		{
+			for (i = 0; i < aux->fd_cnt; i++)
+				file_close(aux->files[i]);
+			free(aux);
+		}
+		palloc_free_page(cmd_line);
+	}
+	return tid;
+}
+
+/* A thread function that installs the descriptors process_spawn()
+ * chose and loads the child's program. */
+static void
+spawn_child(void *aux_)
+{
+	struct spawn_aux *aux = aux_;
+	struct thread *current = thread_current();
+	char *cmd_line = aux->cmd_line;
+
+#ifdef VM
+	supplemental_page_table_init(&current->spt);
+#endif
+	process_init();
+
+	for (int i = 0; i < aux->fd_cnt; i++)
+		current->fdt[aux->fds[i]] = aux->files[i];
+	free(aux);
+
+	if (process_exec(cmd_line) < 0)
+	{
+		// exit() 시스템 콜과 같은 일을 한다.
+		current->exit_status = -1;
+		printf("%s: exit(%d)\n", current->name, -1);
+		thread_exit();
+	}
+	NOT_REACHED();
+}
+
 /* Switch the current execution context to the f_name.
  * Returns -1 on fail. */
 int process_exec(void *f_name)
@@ -263,6 +356,11 @@ int process_exec(void *f_name)
 	_if.R.rdi = count;
 	_if.R.rsi = (char *)_if.rsp + 8;
 
+#ifdef VM
+	// 이 실행 파일이 지난번 시작할 때 fault를 낸 페이지들을 미리 읽어 둔다.
+	launch_prefetch(thread_current()->running);
+#endif
+
 	// hex_dump(_if.rsp, _if.rsp, USER_STACK - (uint64_t)_if.rsp, true); // user stack을 16진수로 프린트
 
 	palloc_free_page(file_name);
@@ -564,6 +662,7 @@ load(const char *file_name, struct intr_frame *if_)
 	}
 
 	// 스레드가 삭제될 때 파일을 닫을 수 있게 구조체에 파일을 저장해둔다.
+	file_close(t->running); // fork로 물려받은 실행 파일이 있다면 닫는다.
 	t->running = file;
 	// 현재 실행중인 파일은 수정할 수 없게 막는다.
 	file_deny_write(file);
@@ -763,6 +862,9 @@ lazy_load_segment(struct page *page, void *aux)
 	size_t page_zero_bytes = meta->page_zero_bytes;
 	off_t ofs = meta->ofs;
 
+	/* 다 읽었으면 aux는 더 이상 필요 없다. */
+	free(meta);
+
 	/* Load this page. */
 	file_seek(file, ofs);
 
@@ -811,8 +913,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		meta->page_zero_bytes = page_zero_bytes;
         meta->ofs = ofs;
 
-		// 왜 VM_ANON?
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage, writable, lazy_load_segment, meta)) {
+		// 왜 VM_ANON? 한 번 읽고 나면 스왑으로 내보내기 때문.
+		// VM_MARKER_1: 파일에서 읽어오는 페이지 (fault-around 대상)
+		if (!vm_alloc_page_with_initializer (VM_ANON | VM_MARKER_1, upage, writable, lazy_load_segment, meta)) {
 			free(meta);
 			return false;
 		} 
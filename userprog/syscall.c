@@ -14,10 +14,17 @@
 #include "devices/input.h"
 #include "lib/kernel/stdio.h"
 #include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "threads/mmu.h"
+#ifdef VM
+#include "vm/vm.h"
+#include "vm/rss.h"
+#endif
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
-void check_address(void *addr);
+void check_address(const void *addr);
+void check_string(const char *str);
 void halt(void);
 void exit(int status);
 bool create(const char *file, unsigned initial_size);
@@ -32,6 +39,15 @@ void close(int fd);
 tid_t fork(const char *thread_name, struct intr_frame *f);
 int exec(const char *cmd_line);
 int wait(int pid);
+int spawn(const char *cmd_line, const int *fd_map);
+#ifdef VM
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
+void munmap(void *addr);
+int madvise(void *addr, size_t length, int advice);
+int msync(void *addr, size_t length, int flags);
+int set_rss_limit(size_t pages);
+long long get_rss(int what);
+#endif
 
 /* System call.
  *
@@ -81,6 +97,9 @@ void syscall_handler(struct intr_frame *f UNUSED)
 	case SYS_WAIT:
 		f->R.rax = wait(f->R.rdi);
 		break;
+	case SYS_SPAWN:
+		f->R.rax = spawn((const char *)f->R.rdi, (const int *)f->R.rsi);
+		break;
 	case SYS_CREATE:
 		f->R.rax = create(f->R.rdi, f->R.rsi);
 		break;
@@ -107,10 +126,31 @@ void syscall_handler(struct intr_frame *f UNUSED)
 		break;
 	case SYS_CLOSE:
 		close(f->R.rdi);
+		break;
+#ifdef VM
+	case SYS_MMAP:
+		f->R.rax = (uint64_t)mmap((void *)f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
+		break;
+	case SYS_MUNMAP:
+		munmap((void *)f->R.rdi);
+		break;
+	case SYS_MADVISE:
+		f->R.rax = madvise((void *)f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_MSYNC:
+		f->R.rax = msync((void *)f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_SETRSSLIMIT:
+		f->R.rax = set_rss_limit(f->R.rdi);
+		break;
+	case SYS_GETRSS:
+		f->R.rax = get_rss(f->R.rdi);
+		break;
+#endif
 	}
 }
 
-void check_address(void *addr)
+void check_address(const void *addr)
 {
 	if (addr == NULL)
 		exit(-1);
@@ -120,6 +160,29 @@ void check_address(void *addr)
 	// 	exit(-1);
 }
 
+// 문자열이 걸친 페이지를 하나씩 확인한다. 첫 바이트만 보면 문자열이
+// 매핑되지 않은 페이지로 넘어갈 때 커널에서 페이지 폴트가 난다.
+// 문자열이 PGSIZE보다 길면 거기까지만 본다.
+void check_string(const char *str)
+{
+	for (size_t i = 0; i < PGSIZE; i++)
+	{
+		if (i == 0 || pg_ofs(str + i) == 0)
+		{
+			check_address(str + i);
+#ifdef VM
+			if (spt_find_page(&thread_current()->spt, (void *)(str + i)) == NULL)
+				exit(-1);
+#else
+			if (pml4_get_page(thread_current()->pml4, str + i) == NULL)
+				exit(-1);
+#endif
+		}
+		if (str[i] == '\0')
+			return;
+	}
+}
+
 void halt(void)
 {
 	power_off();
@@ -192,6 +255,15 @@ void close(int fd)
 int read(int fd, void *buffer, unsigned size)
 {
 	check_address(buffer);
+#ifdef VM
+	// 커널이 대신 쓰게 되므로 버퍼 전체가 쓰기 가능한 페이지여야 한다.
+	for (void *upage = pg_round_down(buffer); upage < buffer + size; upage += PGSIZE)
+	{
+		struct page *page = spt_find_page(&thread_current()->spt, upage);
+		if (page == NULL || !page->writable)
+			exit(-1);
+	}
+#endif
 
 	char *ptr = (char *)buffer;
 	int bytes_read = 0;
@@ -257,7 +329,7 @@ tid_t fork(const char *thread_name, struct intr_frame *f)
 
 int exec(const char *cmd_line)
 {
-	check_address(cmd_line);
+	check_string(cmd_line);
 
 	// process.c 파일의 process_create_initd 함수와 유사하다.
 	// 단, 스레드를 새로 생성하는 건 fork에서 수행하므로
@@ -281,3 +353,129 @@ int wait(int pid)
 {
 	return process_wait(pid);
 }
+
+int spawn(const char *cmd_line, const int *fd_map)
+{
+	check_string(cmd_line);
+
+	// fd_map은 -1로 끝나는 fd 목록이다. NULL이면 아무 파일도 물려주지 않는다.
+	int fd_cnt = 0;
+	if (fd_map != NULL)
+	{
+		for (;; fd_cnt++)
+		{
+			if (fd_cnt >= FDT_COUNT_LIMIT)
+				return -1;
+			check_address(&fd_map[fd_cnt]);
+			if (fd_map[fd_cnt] == -1)
+				break;
+		}
+	}
+
+	// exec처럼 명령줄을 커널 페이지로 복사한다. 이 페이지는 자식에게 넘어간다.
+	char *cmd_line_copy = palloc_get_page(0);
+	if (cmd_line_copy == NULL)
+		return -1;
+	strlcpy(cmd_line_copy, cmd_line, PGSIZE);
+
+	// fork와 달리 주소 공간을 복사하지 않으므로 자식이 로드될 때까지 기다리지 않는다.
+	return process_spawn(cmd_line_copy, fd_map, fd_cnt);
+}
+
+#ifdef VM
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
+{
+	// 주소와 오프셋은 페이지 정렬되어 있어야 하고, 매핑 전체가 유저 영역이어야 한다.
+	if (addr == NULL || pg_ofs(addr) != 0 || offset % PGSIZE != 0 || (long)length <= 0)
+		return NULL;
+	if (!is_user_vaddr(addr) || !is_user_vaddr(addr + length - 1) || addr + length < addr)
+		return NULL;
+	if (fd < 2)
+		return NULL;
+
+	struct file *file = process_get_file(fd);
+	if (file == NULL)
+		return NULL;
+
+	// MAP_POPULATE이면 첫 접근을 기다리지 않고 매핑 전체를 바로 읽어 둔다.
+	bool populate = (writable & VM_MAP_POPULATE) != 0;
+	writable &= ~VM_MAP_POPULATE;
+
+	lock_acquire(&filesys_lock);
+	void *mapped = do_mmap(addr, length, writable, file, offset);
+	if (mapped != NULL && populate)
+		vm_prefetch(mapped, length, true);
+	lock_release(&filesys_lock);
+	return mapped;
+}
+
+void munmap(void *addr)
+{
+	lock_acquire(&filesys_lock);
+	do_munmap(addr);
+	lock_release(&filesys_lock);
+}
+
+int madvise(void *addr, size_t length, int advice)
+{
+	// 범위는 페이지 정렬된 유저 영역이어야 한다. 매핑되지 않은 페이지는 건너뛴다.
+	if (pg_ofs(addr) != 0 || !is_user_vaddr(addr))
+		return -1;
+	if (length > 0 && (!is_user_vaddr(addr + length - 1) || addr + length < addr))
+		return -1;
+
+	lock_acquire(&filesys_lock);
+	bool success = vm_advise(addr, length, advice);
+	lock_release(&filesys_lock);
+	return success ? 0 : -1;
+}
+
+int msync(void *addr, size_t length, int flags)
+{
+	if (pg_ofs(addr) != 0 || !is_user_vaddr(addr))
+		return -1;
+	if (length > 0 && (!is_user_vaddr(addr + length - 1) || addr + length < addr))
+		return -1;
+	if ((flags & ~(VM_MS_ASYNC | VM_MS_INVALIDATE | VM_MS_SYNC)) != 0
+		|| (flags & (VM_MS_ASYNC | VM_MS_SYNC)) == (VM_MS_ASYNC | VM_MS_SYNC))
+		return -1;
+
+	// MS_ASYNC는 주기적으로 도는 flusher에 맡기고 바로 돌아간다.
+	if (!(flags & VM_MS_SYNC))
+		return 0;
+
+	lock_acquire(&filesys_lock);
+	bool success = do_msync(addr, length);
+	lock_release(&filesys_lock);
+	return success ? 0 : -1;
+}
+
+int set_rss_limit(size_t pages)
+{
+	// 한도를 넘어도 메모리가 모자라기 전까지는 아무 일도 없다. 0이면 한도가 없다.
+	vm_set_rss_limit(thread_current(), pages);
+	return 0;
+}
+
+long long get_rss(int what)
+{
+	struct thread *curr = thread_current();
+	long long value = -1;
+
+	vm_frame_lock_acquire();
+	switch (what)
+	{
+	case VM_RSS_RESIDENT:
+		value = curr->spt.rss;
+		break;
+	case VM_RSS_LIMIT:
+		value = curr->rss_limit;
+		break;
+	case VM_RSS_WORKING_SET:
+		value = rss_working_set(&curr->spt);
+		break;
+	}
+	vm_frame_lock_release();
+	return value;
+}
+#endif
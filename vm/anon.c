@@ -1,7 +1,12 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #include "devices/disk.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include <bitmap.h>
+#include <string.h>
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -9,6 +14,13 @@ static bool anon_swap_in(struct page *page, void *kva);
 static bool anon_swap_out(struct page *page);
 static void anon_destroy(struct page *page);
 
+/* Number of disk sectors that make up one swap slot. */
+#define SECTORS_PER_PAGE (PGSIZE / DISK_SECTOR_SIZE)
+
+/* One bit per swap slot; true means the slot is in use. */
+static struct bitmap *swap_table;
+static struct lock swap_lock;
+
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
 	.swap_in = anon_swap_in,
@@ -23,19 +35,58 @@ static const struct page_operations anon_ops = {
 void vm_anon_init(void)
 {
 	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	swap_disk = disk_get(1, 1);
+	lock_init(&swap_lock);
+	size_t slot_cnt = swap_disk != NULL ? disk_size(swap_disk) / SECTORS_PER_PAGE : 0;
+	swap_table = bitmap_create(slot_cnt);
+	if (swap_table == NULL)
+		PANIC("swap table creation failed");
+	zswap_init();
+}
+
+/* Writes the page at KVA into swap slot SLOT on the swap disk. */
+void swap_slot_write(size_t slot, const void *kva)
+{
+	for (size_t i = 0; i < SECTORS_PER_PAGE; i++)
+		disk_write(swap_disk, slot * SECTORS_PER_PAGE + i,
+				   (const uint8_t *)kva + i * DISK_SECTOR_SIZE);
+}
+
+/* Reads swap slot SLOT from the swap disk into the page at KVA. */
+static void
+swap_slot_read(size_t slot, void *kva)
+{
+	for (size_t i = 0; i < SECTORS_PER_PAGE; i++)
+		disk_read(swap_disk, slot * SECTORS_PER_PAGE + i,
+				  (uint8_t *)kva + i * DISK_SECTOR_SIZE);
+}
+
+/* Returns SLOT to the free pool, dropping any cached copy. */
+static void
+swap_slot_free(size_t slot)
+{
+	zswap_invalidate(slot);
+	lock_acquire(&swap_lock);
+	bitmap_reset(swap_table, slot);
+	lock_release(&swap_lock);
 }
 
 /* Initialize the file mapping */
 // 이 함수는 익명 페이지의 핸들러를 page->operations에 설정합니다.
 // 현재는 빈 구조체인 anon_page에서 일부 정보를 업데이트해야 할 수도 있습니다.
 // 이 함수는 익명 페이지(즉, VM_ANON)의 초기화 함수로 사용됩니다.
-bool anon_initializer(struct page *page, enum vm_type type, void *kva)
+bool anon_initializer(struct page *page, enum vm_type type, void *kva UNUSED)
 {
+	/* Read the uninit aux before the union is overwritten. */
+	struct file_meta_data *meta = (type & VM_MARKER_1) ? page->uninit.aux : NULL;
+
 	/* Set up the handler */
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->swap_slot = SWAP_SLOT_NONE;
+	anon_page->from_file = meta != NULL && meta->page_read_bytes > 0;
+	return true;
 }
 
 /* Swap in the page by read contents from the swap disk. */
@@ -43,6 +94,20 @@ static bool
 anon_swap_in(struct page *page, void *kva)
 {
 	struct anon_page *anon_page = &page->anon;
+	size_t slot = anon_page->swap_slot;
+	if (slot == SWAP_SLOT_NONE)
+	{
+		/* Discarded by madvise(): starts over as zeros. */
+		memset(kva, 0, PGSIZE);
+		return true;
+	}
+
+	/* The compressed cache sits in front of the disk. */
+	if (!zswap_load(slot, kva))
+		swap_slot_read(slot, kva);
+	swap_slot_free(slot);
+	anon_page->swap_slot = SWAP_SLOT_NONE;
+	return true;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
@@ -50,6 +115,19 @@ static bool
 anon_swap_out(struct page *page)
 {
 	struct anon_page *anon_page = &page->anon;
+
+	lock_acquire(&swap_lock);
+	size_t slot = bitmap_scan_and_flip(swap_table, 0, 1, false);
+	lock_release(&swap_lock);
+	if (slot == BITMAP_ERROR)
+		return false;
+
+	/* Park the page compressed in RAM if possible; the cache writes
+	 * it to SLOT later, or never if it is faulted back first. */
+	if (!zswap_store(slot, page->frame->kva))
+		swap_slot_write(slot, page->frame->kva);
+	anon_page->swap_slot = slot;
+	return true;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
@@ -60,4 +138,28 @@ anon_destroy(struct page *page)
 	struct anon_page *anon_page = &page->anon;
 	// anonymous page에 의해 유지되던 리소스를 해제합니다.
 	// page struct를 명시적으로 해제할 필요는 없으며, 호출자가 이를 수행해야 합니다.
+	/* Release the frame first: until then eviction may still give
+	 * the page a swap slot. */
+	vm_free_frame(page);
+	if (anon_page->swap_slot != SWAP_SLOT_NONE)
+	{
+		swap_slot_free(anon_page->swap_slot);
+		anon_page->swap_slot = SWAP_SLOT_NONE;
+	}
+}
+
+/* Throws away the contents of PAGE, frame and swap slot alike.  The
+ * next access reads zeros, so PAGE must not be from_file. */
+void anon_discard(struct page *page)
+{
+	struct anon_page *anon_page = &page->anon;
+
+	ASSERT(!anon_page->from_file);
+	/* With the frame gone nobody can swap the page out any more. */
+	vm_free_frame(page);
+	if (anon_page->swap_slot != SWAP_SLOT_NONE)
+	{
+		swap_slot_free(anon_page->swap_slot);
+		anon_page->swap_slot = SWAP_SLOT_NONE;
+	}
 }
@@ -0,0 +1,98 @@
+/* faultstat.c: Page fault counters and latency histograms.
+ *
+ * vm_try_handle_fault() times every fault with the TSC and reports
+ * it here under the class it turned out to be.  The kernel keeps one
+ * log2 histogram per class, printed at shutdown, and each process
+ * counts its own faults per class in its spt.  User programs read
+ * both through two inspect interrupts, like get_phys_addr(). */
+
+#include "vm/faultstat.h"
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+static const char *class_names[FAULT_CLASS_CNT] = {
+	"lazy-anon", "lazy-file", "stack", "swap-in", "cow", "write-protect", "invalid",
+};
+
+static long long hist[FAULT_CLASS_CNT][FAULT_HIST_BUCKETS];
+static uint64_t total_cycles[FAULT_CLASS_CNT];
+
+static void inspect_fault_cnt(struct intr_frame *f);
+static void inspect_fault_hist(struct intr_frame *f);
+
+/* Tool for reading fault statistics from user programs, through
+ * int 0x45 and int 0x46.
+ * Input:
+ *   @RAX - Fault class
+ *   @RDX - Histogram bucket (int 0x46 only)
+ * Output:
+ *   @RAX - Faults of the class taken by the current process (0x45),
+ *          or in the bucket across the system (0x46). */
+void fault_stat_init(void)
+{
+	intr_register_int(0x45, 3, INTR_OFF, inspect_fault_cnt, "Inspect Page Fault Count");
+	intr_register_int(0x46, 3, INTR_OFF, inspect_fault_hist, "Inspect Page Fault Latency");
+}
+
+/* Returns the histogram bucket of a fault that took CYCLES. */
+static int
+bucket_of(uint64_t cycles)
+{
+	int b = 0;
+	while (cycles > 1 && b < FAULT_HIST_BUCKETS - 1)
+	{
+		cycles >>= 1;
+		b++;
+	}
+	return b;
+}
+
+/* Accounts one fault of CLASS that took CYCLES to the system and to
+ * the current process. */
+void fault_stat_record(enum fault_class class, uint64_t cycles)
+{
+	ASSERT(class < FAULT_CLASS_CNT);
+
+	enum intr_level old_level = intr_disable();
+	hist[class][bucket_of(cycles)]++;
+	total_cycles[class] += cycles;
+	thread_current()->spt.fault_cnt[class]++;
+	intr_set_level(old_level);
+}
+
+static void
+inspect_fault_cnt(struct intr_frame *f)
+{
+	uint64_t class = f->R.rax;
+	f->R.rax = class < FAULT_CLASS_CNT ? thread_current()->spt.fault_cnt[class] : 0;
+}
+
+static void
+inspect_fault_hist(struct intr_frame *f)
+{
+	uint64_t class = f->R.rax, bucket = f->R.rdx;
+	f->R.rax = class < FAULT_CLASS_CNT && bucket < FAULT_HIST_BUCKETS ? hist[class][bucket] : 0;
+}
+
+/* Prints one line per class that saw faults: the count, the mean
+ * latency, and the non-empty buckets as log2(cycles):count. */
+void fault_stat_print(void)
+{
+	for (int c = 0; c < FAULT_CLASS_CNT; c++)
+	{
+		long long cnt = 0;
+		for (int b = 0; b < FAULT_HIST_BUCKETS; b++)
+			cnt += hist[c][b];
+		if (cnt == 0)
+			continue;
+
+		printf("  %s: %lld faults, mean %llu cycles,", class_names[c], cnt,
+			   (unsigned long long)(total_cycles[c] / cnt));
+		for (int b = 0; b < FAULT_HIST_BUCKETS; b++)
+			if (hist[c][b] != 0)
+				printf(" %d:%lld", b, hist[c][b]);
+		printf("\n");
+	}
+}
@@ -1,10 +1,36 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+
+/* Ticks between two passes of the flusher, which bounds how long
+ * mapped data stays dirty in memory. */
+#define FLUSH_INTERVAL (5 * TIMER_FREQ)
+
+/* Most pages msync() gathers into one write. */
+#define MSYNC_CLUSTER 8
+
+/* Statistics. */
+static long long msync_page_cnt;	/* Pages written by msync(). */
+static long long msync_write_cnt;	/* Writes they took. */
+static long long flush_page_cnt;	/* Pages written by flusher passes. */
+
+/* Dirty pages are copied here under the frame table lock and written
+ * from here once it is released.  Guarded by filesys_lock. */
+static uint8_t *bounce;
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
 static void file_backed_destroy (struct page *page);
+static void flusher (void *aux);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations file_ops = {
@@ -17,42 +43,369 @@ static const struct page_operations file_ops = {
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	bounce = palloc_get_page (PAL_ASSERT);
+	thread_create ("flusher", PRI_DEFAULT, flusher, NULL);
 }
 
 /* Initialize the file backed page */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+file_backed_initializer (struct page *page, enum vm_type type UNUSED, void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &file_ops;
 
-	struct file_page *file_page = &page->file;
+	/* The mapping itself is filled in by lazy_load_file(), which
+	 * still has the uninit aux. */
+	return true;
+}
+
+/* Reads the file range described by META into the page at KVA and
+ * zero-fills the remainder. */
+static bool
+read_file_page (const struct file_meta_data *meta, void *kva) {
+	if (file_read_at (meta->file, kva, meta->page_read_bytes, meta->ofs)
+			!= (off_t) meta->page_read_bytes)
+		return false;
+	memset ((uint8_t *) kva + meta->page_read_bytes, 0, meta->page_zero_bytes);
+	return true;
+}
+
+/* Acquires filesys_lock unless the current thread holds it already,
+ * as a system call that faults on its buffer does.  Returns true if
+ * it was acquired here, to be passed to fs_lock_release(). */
+static bool
+fs_lock_acquire (void) {
+	if (lock_held_by_current_thread (&filesys_lock))
+		return false;
+	lock_acquire (&filesys_lock);
+	return true;
+}
+
+static void
+fs_lock_release (bool acquired) {
+	if (acquired)
+		lock_release (&filesys_lock);
+}
+
+/* Returns true if PAGE is loaded and its owner dirtied it.  Must hold
+ * the frame table lock. */
+static bool
+page_is_dirty (struct page *page) {
+	uint64_t *pml4 = page->owner->pml4;
+	return page->frame != NULL && pml4 != NULL && pml4_is_dirty (pml4, page->va);
+}
+
+/* If PAGE is dirty, copies it to BOUNCE and returns the bytes to
+ * write, else returns 0.  The dirty bit is cleared first, so a store
+ * that races with the copy marks the page dirty again instead of
+ * getting lost.  Must hold filesys_lock and the frame table lock. */
+static off_t
+copy_dirty (struct page *page) {
+	struct file_meta_data *meta = &page->file.meta;
+
+	if (!page_is_dirty (page))
+		return 0;
+	pml4_set_dirty (page->owner->pml4, page->va, false);
+	memcpy (bounce, page->frame->kva, meta->page_read_bytes);
+	return meta->page_read_bytes;
+}
+
+/* Writes PAGE back to its file if the owner dirtied it.  The page is
+ * copied out under the frame table lock, which is released before the
+ * write: eviction holds it and must never wait for the file system.
+ * Must hold filesys_lock, which keeps the copy and the write of one
+ * page from interleaving with another's. */
+static bool
+write_back (struct page *page) {
+	struct file_meta_data *meta = &page->file.meta;
+	off_t bytes;
+
+	ASSERT (lock_held_by_current_thread (&filesys_lock));
+	vm_frame_lock_acquire ();
+	bytes = copy_dirty (page);
+	vm_frame_lock_release ();
+	if (bytes > 0)
+		file_write_at (meta->file, bounce, bytes, meta->ofs);
+	return bytes > 0;
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	return read_file_page (&file_page->meta, kva);
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.  Eviction
+ * holds the frame table lock, so only a clean page can go; a dirty
+ * one is left to file_write_back_all(). */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	return !page_is_dirty (page);
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	bool acquired = fs_lock_acquire ();
+
+	write_back (page);
+	vm_free_frame (page);
+	file_close (file_page->meta.file);
+	fs_lock_release (acquired);
+}
+
+/* First fault on a mapped page: record the mapping and load it. */
+static bool
+lazy_load_file (struct page *page, void *aux) {
+	struct file_page *file_page = aux;
+
+	page->file = *file_page;
+	free (file_page);
+	return read_file_page (&page->file.meta, page->frame->kva);
+}
+
+/* Gives the current process, a fork child, its own lazy copy of the
+ * parent's mapped page SRC.  Dirty contents are written back first so
+ * the child reads them from the file. */
+bool
+file_backed_fork (struct page *src) {
+	struct file_page *aux = malloc (sizeof *aux);
+	if (aux == NULL)
+		return false;
+
+	bool acquired = fs_lock_acquire ();
+	write_back (src);
+	fs_lock_release (acquired);
+
+	*aux = src->file;
+	aux->meta.file = file_reopen (src->file.meta.file);
+	if (aux->meta.file == NULL
+			|| !vm_alloc_page_with_initializer (VM_FILE | VM_MARKER_1, src->va,
+				src->writable, lazy_load_file, aux)) {
+		file_close (aux->meta.file);
+		free (aux);
+		return false;
+	}
+	return true;
+}
+
+/* Writes PAGE back if it is dirty and releases its frame.  The next
+ * access reads it from the file again. */
+void
+file_backed_discard (struct page *page) {
+	bool acquired = fs_lock_acquire ();
+	write_back (page);
+	vm_free_frame (page);
+	fs_lock_release (acquired);
+}
+
+/* Returns the page at VA in SPT if it is a loaded file page that its
+ * owner dirtied.  Must hold the frame table lock. */
+static struct page *
+dirty_file_page (struct supplemental_page_table *spt, void *va) {
+	struct page *page = spt_find_page (spt, va);
+
+	if (page == NULL || VM_TYPE (page->operations->type) != VM_FILE
+			|| page->frame == NULL)
+		return NULL;
+	return pml4_is_dirty (page->owner->pml4, va) ? page : NULL;
+}
+
+/* Writes the dirty mapped pages of the current process in [ADDR,
+ * ADDR + LENGTH) back to their files.  Runs of up to MSYNC_CLUSTER
+ * dirty pages that are contiguous in the same file are copied out
+ * under the frame table lock and written with a single call.
+ * Returns false if part of the range is not mapped. */
+bool
+do_msync (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *end = (uint8_t *) addr + length;
+	uint8_t *va;
+
+	for (va = addr; va < end; va += PGSIZE)
+		if (spt_find_page (spt, va) == NULL)
+			return false;
+
+	uint8_t *buf = palloc_get_multiple (0, MSYNC_CLUSTER);
+	if (buf == NULL)
+		return false;
+
+	va = addr;
+	while (va < end) {
+		struct file *file = NULL;
+		off_t ofs = 0, bytes = 0;
+		size_t n;
+
+		vm_frame_lock_acquire ();
+		for (n = 0; n < MSYNC_CLUSTER && va < end; n++) {
+			struct page *page = dirty_file_page (spt, va);
+			struct file_meta_data *meta;
+
+			if (page == NULL) {
+				/* A clean page ends the run, or is skipped if the
+				 * run has not started. */
+				if (n == 0)
+					va += PGSIZE;
+				break;
+			}
+			meta = &page->file.meta;
+			if (n == 0) {
+				file = meta->file;
+				ofs = meta->ofs;
+			} else if (file_get_inode (meta->file) != file_get_inode (file)
+					|| meta->ofs != ofs + bytes)
+				break;
+
+			pml4_set_dirty (page->owner->pml4, va, false);
+			memcpy (buf + bytes, page->frame->kva, meta->page_read_bytes);
+			bytes += meta->page_read_bytes;
+			va += PGSIZE;
+			/* Only the file's last page is partial. */
+			if (meta->page_read_bytes < PGSIZE) {
+				n++;
+				break;
+			}
+		}
+		vm_frame_lock_release ();
+
+		if (bytes > 0) {
+			file_write_at (file, buf, bytes, ofs);
+			msync_page_cnt += n;
+			msync_write_cnt++;
+		}
+	}
+
+	palloc_free_multiple (buf, MSYNC_CLUSTER);
+	return true;
+}
+
+/* Writes back each dirty mapped page in the frame table, one page per
+ * hold of the locks, and returns how many were written.  Pages are
+ * left mapped and clean, so eviction can take them. */
+size_t
+file_write_back_all (void) {
+	bool wrapped, done = false;
+	size_t visited = 0, written = 0;
+
+	while (!done) {
+		struct file *file = NULL;
+		off_t ofs = 0, bytes = 0;
+		bool acquired = fs_lock_acquire ();
+
+		vm_frame_lock_acquire ();
+		struct frame *frame = vm_frame_flush_next (&wrapped);
+		if (frame == NULL)
+			done = true;
+		else {
+			/* Back at the start of the table: this frame is the
+			 * pass's last. */
+			done = wrapped && visited > 0;
+			visited++;
+			if (frame->page != NULL && page_get_type (frame->page) == VM_FILE) {
+				file = frame->page->file.meta.file;
+				ofs = frame->page->file.meta.ofs;
+				bytes = copy_dirty (frame->page);
+			}
+		}
+		vm_frame_lock_release ();
+
+		/* FILE stays open: pages close it under filesys_lock. */
+		if (bytes > 0) {
+			file_write_at (file, bounce, bytes, ofs);
+			flush_page_cnt++;
+			written++;
+		}
+		fs_lock_release (acquired);
+	}
+	return written;
+}
+
+/* Every FLUSH_INTERVAL, writes back each dirty mapped page. */
+static void
+flusher (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (FLUSH_INTERVAL);
+		file_write_back_all ();
+	}
+}
+
+/* Prints how mapped data got written back. */
+void
+file_print_stats (void) {
+	printf ("Writeback: %lld pages in %lld msync writes, %lld pages by the flusher\n",
+			msync_page_cnt, msync_write_cnt, flush_page_cnt);
 }
 
 /* Do the mmap */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	off_t file_len = file_length (file);
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	size_t i;
+
+	if (file_len == 0 || offset > file_len)
+		return NULL;
+
+	/* The whole range must be free before anything is mapped. */
+	for (i = 0; i < page_cnt; i++)
+		if (spt_find_page (spt, (uint8_t *) addr + i * PGSIZE) != NULL)
+			return NULL;
+
+	for (i = 0; i < page_cnt; i++) {
+		void *upage = (uint8_t *) addr + i * PGSIZE;
+		off_t ofs = offset + i * PGSIZE;
+		off_t left = file_len > ofs ? file_len - ofs : 0;
+		struct file_page *aux = malloc (sizeof *aux);
+
+		if (aux == NULL)
+			goto fail;
+		/* Each page owns a handle, so it survives close() and munmap()
+		 * of its neighbours. */
+		aux->meta.file = file_reopen (file);
+		aux->meta.ofs = ofs;
+		aux->meta.page_read_bytes = left < PGSIZE ? left : PGSIZE;
+		aux->meta.page_zero_bytes = PGSIZE - aux->meta.page_read_bytes;
+		aux->map_addr = addr;
+		if (aux->meta.file == NULL
+				|| !vm_alloc_page_with_initializer (VM_FILE | VM_MARKER_1, upage,
+					writable, lazy_load_file, aux)) {
+			file_close (aux->meta.file);
+			free (aux);
+			goto fail;
+		}
+	}
+	return addr;
+
+fail:
+	do_munmap (addr);
+	return NULL;
+}
+
+/* Returns the mapping information of file page PAGE, whether or not
+ * it has been faulted in yet. */
+static struct file_page *
+mapping_of (struct page *page) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT)
+		return VM_TYPE (page->uninit.type) == VM_FILE ? page->uninit.aux : NULL;
+	return VM_TYPE (page->operations->type) == VM_FILE ? &page->file : NULL;
 }
 
 /* Do the munmap */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *start = addr;
+	struct page *page;
+
+	/* A mapping is the run of pages tagged with its start address. */
+	while ((page = spt_find_page (spt, addr)) != NULL) {
+		struct file_page *map = mapping_of (page);
+		if (map == NULL || map->map_addr != start)
+			break;
+		spt_remove_page (spt, page);
+		addr = (uint8_t *) addr + PGSIZE;
+	}
 }
@@ -0,0 +1,295 @@
+/* ksm.c: Same-page merging for anonymous memory.
+ *
+ * ksmd is a PRI_MIN kernel thread that walks the frame table a few
+ * pages at a time.  A private anonymous frame whose contents hash did
+ * not change since the previous visit is looked up first among the
+ * shared frames (the stable table), then among the other quiet
+ * frames seen during this pass (the unstable table).  On a match
+ * both pages are write-protected, compared byte for byte, and the
+ * page is remapped read-only onto a single shared frame.  A write to
+ * a shared page faults into vm_handle_wp(), which gives the writer a
+ * private copy again.
+ *
+ * Shared frames stay in the frame table, charged to no one, and sit
+ * in a stable bucket as well until their last page lets go of them.
+ * Evicting one swaps out every page mapping it through the rmap,
+ * each to a slot of its own since swap slots are never shared. */
+
+#include "vm/ksm.h"
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#include "vm/vm.h"
+
+/* Ticks ksmd sleeps between batches. */
+#define KSM_SLEEP_TICKS (TIMER_FREQ / 10)
+
+#define KSM_BUCKETS 64
+#define KSM_BUCKET(sum) ((sum) % KSM_BUCKETS)
+
+size_t ksm_pages_to_scan = 100;
+
+/* Shared frames, by checksum. */
+static struct list stable[KSM_BUCKETS];
+/* Quiet private frames seen this pass. */
+static struct list unstable[KSM_BUCKETS];
+
+/* Statistics. */
+static long long pages_shared;	/* Shared frames in use. */
+static long long pages_sharing; /* Pages mapped onto a shared frame. */
+static long long full_scans;	/* Passes over the whole frame table. */
+static long long evict_cnt;		/* Shared frames evicted. */
+
+static void ksmd(void *aux);
+static void inspect_ksm_cnt(struct intr_frame *f);
+
+/* Starts ksmd and the tool for reading the statistics from user
+ * programs, through int 0x47.
+ * Input:
+ *   @RAX - 0 for pages shared, 1 for pages saved
+ * Output:
+ *   @RAX - The count, as ksm_print_stats() prints it. */
+void ksm_init(void)
+{
+	for (int i = 0; i < KSM_BUCKETS; i++)
+	{
+		list_init(&stable[i]);
+		list_init(&unstable[i]);
+	}
+	intr_register_int(0x47, 3, INTR_OFF, inspect_ksm_cnt, "Inspect KSM Count");
+	if (ksm_pages_to_scan > 0)
+		thread_create("ksmd", PRI_MIN, ksmd, NULL);
+}
+
+/* Drops FRAME from the unstable table, if it is there. */
+void ksm_forget(struct frame *frame)
+{
+	if (frame->ksm_candidate)
+	{
+		list_remove(&frame->ksm_elem);
+		frame->ksm_candidate = false;
+	}
+}
+
+/* Starts a new pass: every frame has to prove it is quiet again. */
+static void
+unstable_reset(void)
+{
+	for (int i = 0; i < KSM_BUCKETS; i++)
+		while (!list_empty(&unstable[i]))
+			list_entry(list_pop_front(&unstable[i]), struct frame, ksm_elem)->ksm_candidate = false;
+	full_scans++;
+}
+
+/* Finds a frame in BUCKETS whose contents equal KVA. */
+static struct frame *
+table_find(struct list *buckets, uint64_t sum, const void *kva)
+{
+	struct list *bucket = &buckets[KSM_BUCKET(sum)];
+	for (struct list_elem *e = list_begin(bucket); e != list_end(bucket); e = list_next(e))
+	{
+		struct frame *f = list_entry(e, struct frame, ksm_elem);
+		if (f->checksum == sum && f->kva != kva && !memcmp(f->kva, kva, PGSIZE))
+			return f;
+	}
+	return NULL;
+}
+
+/* Maps PAGE read-only (or back to its own permission) so its
+ * contents cannot change under a comparison. */
+static void
+set_protect(struct page *page, bool protect)
+{
+	pml4_set_page(page->owner->pml4, page->va, page->frame->kva,
+				  protect ? false : page->writable);
+}
+
+/* Turns the private frame TWIN into a shared frame. */
+static void
+promote(struct frame *twin)
+{
+	vm_frame_share(twin);
+	list_push_back(&stable[KSM_BUCKET(twin->checksum)], &twin->ksm_elem);
+	pages_shared++;
+	pages_sharing++;
+}
+
+/* Points the page of private FRAME at SHARED and frees FRAME. */
+static void
+merge(struct frame *shared, struct frame *frame)
+{
+	struct page *page = frame->page;
+
+	vm_frame_detach(frame);
+	vm_frame_unlink(frame, page);
+	vm_frame_link(shared, page);
+	pml4_set_page(page->owner->pml4, page->va, shared->kva, false);
+	shared->share_cnt++;
+	pages_sharing++;
+
+	palloc_free_page(frame->kva);
+	free(frame);
+}
+
+/* Tries to merge the private frame FRAME. */
+static void
+scan_frame(struct frame *frame)
+{
+	struct page *page = frame->page;
+	/* Text frames are shared already. */
+	if (page == NULL || page_get_type(page) != VM_ANON)
+		return;
+	/* Merging would split a 2 MB page for 4 kB saved. */
+	if (pml4_is_huge(page->owner->pml4, page->va))
+		return;
+
+	/* Frames that are still being written are not worth the
+	 * copy-on-write fault merging them would cost. */
+	uint64_t sum = hash_bytes(frame->kva, PGSIZE);
+	if (sum != frame->checksum)
+	{
+		frame->checksum = sum;
+		return;
+	}
+
+	struct frame *shared = table_find(stable, sum, frame->kva);
+	if (shared != NULL)
+	{
+		set_protect(page, true);
+		if (!memcmp(shared->kva, frame->kva, PGSIZE))
+			merge(shared, frame);
+		else
+			set_protect(page, false);
+		return;
+	}
+
+	struct frame *twin = table_find(unstable, sum, frame->kva);
+	if (twin != NULL)
+	{
+		set_protect(page, true);
+		set_protect(twin->page, true);
+		if (!memcmp(twin->kva, frame->kva, PGSIZE))
+		{
+			promote(twin);
+			merge(twin, frame);
+			return;
+		}
+		set_protect(page, false);
+		set_protect(twin->page, false);
+		return;
+	}
+
+	ksm_forget(frame);
+	list_push_back(&unstable[KSM_BUCKET(sum)], &frame->ksm_elem);
+	frame->ksm_candidate = true;
+}
+
+/* Adds a page, such as a fork child's, to the shared FRAME. */
+void ksm_get(struct frame *frame)
+{
+	ASSERT(frame->share_cnt > 0);
+
+	frame->share_cnt++;
+	pages_sharing++;
+}
+
+/* Drops one page's reference to the shared FRAME, freeing it with
+ * the last one. */
+void ksm_put(struct frame *frame)
+{
+	ASSERT(frame->share_cnt > 0);
+
+	pages_sharing--;
+	if (--frame->share_cnt == 0)
+	{
+		list_remove(&frame->ksm_elem);
+		vm_frame_detach(frame);
+		pages_shared--;
+		palloc_free_page(frame->kva);
+		free(frame);
+	}
+}
+
+/* Hands the shared FRAME, mapped by a single page, back to the
+ * caller as a private frame. */
+void ksm_unshare(struct frame *frame)
+{
+	ASSERT(frame->share_cnt == 1);
+
+	list_remove(&frame->ksm_elem);
+	frame->share_cnt = 0;
+	pages_shared--;
+	pages_sharing--;
+}
+
+/* Evicts the shared FRAME: every page mapping it is swapped out on
+ * its own and unmapped, and FRAME leaves the frame table with the
+ * last of them.  Returns false if swap runs out; the pages done by
+ * then fault back from swap and the rest keep sharing FRAME. */
+bool ksm_evict(struct frame *frame)
+{
+	ASSERT(frame->share_cnt == list_size(&frame->rmap));
+
+	while (!list_empty(&frame->rmap))
+	{
+		struct page *page = list_entry(list_front(&frame->rmap), struct page, rmap_elem);
+		if (!swap_out(page))
+			return false;
+		vm_frame_unlink(frame, page);
+		frame->share_cnt--;
+		pages_sharing--;
+	}
+	list_remove(&frame->ksm_elem);
+	vm_frame_detach(frame);
+	pages_shared--;
+	evict_cnt++;
+	return true;
+}
+
+static void
+ksmd(void *aux UNUSED)
+{
+	for (;;)
+	{
+		for (size_t i = 0; i < ksm_pages_to_scan; i++)
+		{
+			bool wrapped;
+
+			vm_frame_lock_acquire();
+			struct frame *frame = vm_frame_scan_next(&wrapped);
+			if (frame != NULL)
+			{
+				if (wrapped)
+					unstable_reset();
+				scan_frame(frame);
+			}
+			vm_frame_lock_release();
+			if (frame == NULL)
+				break;
+		}
+		timer_sleep(KSM_SLEEP_TICKS);
+	}
+}
+
+static void
+inspect_ksm_cnt(struct intr_frame *f)
+{
+	uint64_t what = f->R.rax;
+	f->R.rax = what == 0 ? pages_shared : what == 1 ? pages_sharing - pages_shared : 0;
+}
+
+/* Prints how much memory merging currently saves. */
+void ksm_print_stats(void)
+{
+	printf("KSM: %lld pages shared, %lld pages saved, %lld full scans, "
+		   "%lld evicted\n",
+		   pages_shared, pages_sharing - pages_shared, full_scans, evict_cnt);
+}
@@ -0,0 +1,99 @@
+/* kswapd.c: Background reclaim of user frames.
+ *
+ * Without it every fault that finds the user pool empty evicts a page
+ * itself and waits for the swap or file write that goes with it.
+ * kswapd keeps a reserve instead: frame_alloc() wakes it when fewer
+ * than kswapd_low_wmark frames are free, and it evicts with the same
+ * clock as the fault path until kswapd_high_wmark frames are free.
+ * It drops the frame table lock after every frame and looks at the
+ * watermark again only after a batch, so faults interleave with it
+ * while the dirty pages of a batch go out back to back. */
+
+#include "vm/kswapd.h"
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* Frames evicted between two looks at the watermark. */
+#define KSWAPD_BATCH 16
+
+size_t kswapd_low_wmark = SIZE_MAX;
+size_t kswapd_high_wmark = SIZE_MAX;
+
+static struct semaphore kswapd_sema;
+/* kswapd_sema is up or kswapd is busy.  Wakers run in any thread, so
+ * it is tested and set with interrupts off. */
+static bool kswapd_pending;
+
+/* Statistics. */
+static long long wakeup_cnt;  /* Times kswapd was woken. */
+static long long reclaim_cnt; /* Frames it gave back. */
+
+static void kswapd(void *aux);
+
+void kswapd_init(void)
+{
+	size_t pool = palloc_user_page_cnt();
+
+	/* About 1.5% and 3% of the user pool, but at least a few frames. */
+	if (kswapd_low_wmark == SIZE_MAX)
+		kswapd_low_wmark = pool / 64 > 4 ? pool / 64 : 4;
+	if (kswapd_high_wmark == SIZE_MAX || kswapd_high_wmark < kswapd_low_wmark)
+		kswapd_high_wmark = kswapd_low_wmark * 2;
+
+	sema_init(&kswapd_sema, 0);
+	if (kswapd_low_wmark > 0)
+		thread_create("kswapd", PRI_DEFAULT, kswapd, NULL);
+}
+
+/* Tells kswapd the pool ran below the low watermark.  Cheap enough
+ * to call on every allocation. */
+void kswapd_wake(void)
+{
+	if (kswapd_low_wmark == 0)
+		return;
+
+	enum intr_level old_level = intr_disable();
+	bool wake = !kswapd_pending;
+	kswapd_pending = true;
+	intr_set_level(old_level);
+	if (wake)
+		sema_up(&kswapd_sema);
+}
+
+static void
+kswapd(void *aux UNUSED)
+{
+	for (;;)
+	{
+		sema_down(&kswapd_sema);
+		wakeup_cnt++;
+
+		/* Stops early if nothing is left to evict, e.g. with swap
+		 * full; the next allocation below the mark wakes it again. */
+		bool progress = true;
+		while (progress && palloc_user_free_cnt() < kswapd_high_wmark)
+			for (int i = 0; i < KSWAPD_BATCH; i++)
+			{
+				progress = vm_reclaim_frame();
+				if (!progress)
+					break;
+				reclaim_cnt++;
+			}
+
+		/* An allocation that finds the pool low after this wakes it
+		 * again. */
+		enum intr_level old_level = intr_disable();
+		kswapd_pending = false;
+		intr_set_level(old_level);
+	}
+}
+
+void kswapd_print_stats(void)
+{
+	printf("kswapd: %lld wakeups, %lld frames reclaimed\n", wakeup_cnt, reclaim_cnt);
+}
@@ -0,0 +1,215 @@
+/* launch.c: Prefetching of executables' startup pages.
+ *
+ * The first run of an executable records the pages of its first
+ * LAUNCH_TRACE_PAGES faults that read from a file.  The trace is kept
+ * under the executable's inode, sorted by address, after the process
+ * filled it or exited.  Every later exec of the same inode loads those
+ * pages right after the binary is loaded, in address order and thus in
+ * file order, so the program starts without taking those faults.
+ *
+ * Traces live as long as the kernel, at most LAUNCH_TRACE_MAX of them,
+ * the least recently launched going first.  They hold no reference to
+ * the inode, so a removed executable is freed as usual.  A trace is
+ * known by the inode's sector, and it is recorded again when the
+ * inode was written since or its length changed.  A file that reuses
+ * the sector and passes both checks only replays a useless trace:
+ * prefetching loads pages of the new process itself. */
+
+#include "vm/launch.h"
+#include <list.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "vm/vm.h"
+
+/* Executables whose traces are kept. */
+#define LAUNCH_TRACE_MAX 16
+/* Faults recorded per executable. */
+#define LAUNCH_TRACE_PAGES 64
+
+struct launch_trace
+{
+	struct list_elem elem;	  /* Element in traces. */
+	disk_sector_t sector;	  /* inode_get_inumber() of the executable. */
+	unsigned write_gen;		  /* inode_write_gen() when recorded. */
+	off_t length;			  /* inode_length() when recorded. */
+	struct supplemental_page_table *recorder; /* Process still recording. */
+	size_t page_cnt;
+	uint64_t vpn[LAUNCH_TRACE_PAGES]; /* Pages faulted, sorted when done. */
+};
+
+static struct list traces; /* Most recently launched first. */
+static struct lock launch_lock;
+
+/* Statistics. */
+static long long record_cnt;   /* Traces recorded. */
+static long long replay_cnt;   /* Execs that replayed a trace. */
+static long long prefetch_cnt; /* Pages they loaded. */
+
+void launch_init(void)
+{
+	list_init(&traces);
+	lock_init(&launch_lock);
+}
+
+static int
+vpn_compare(const void *a_, const void *b_)
+{
+	uint64_t a = *(const uint64_t *)a_;
+	uint64_t b = *(const uint64_t *)b_;
+	return a < b ? -1 : a > b;
+}
+
+static void
+trace_free(struct launch_trace *t)
+{
+	list_remove(&t->elem);
+	free(t);
+}
+
+/* Ends the recording of T by the process that was recording it. */
+static void
+trace_finish(struct launch_trace *t)
+{
+	qsort(t->vpn, t->page_cnt, sizeof *t->vpn, vpn_compare);
+	t->recorder->launch = NULL;
+	t->recorder = NULL;
+	record_cnt++;
+}
+
+/* Returns a new trace for INODE, making room for it if needed, or
+ * NULL if every trace is still being recorded or out of memory. */
+static struct launch_trace *
+trace_create(struct inode *inode)
+{
+	if (list_size(&traces) >= LAUNCH_TRACE_MAX)
+	{
+		struct list_elem *e;
+		for (e = list_rbegin(&traces); e != list_rend(&traces); e = list_prev(e))
+			if (list_entry(e, struct launch_trace, elem)->recorder == NULL)
+				break;
+		if (e == list_rend(&traces))
+			return NULL;
+		trace_free(list_entry(e, struct launch_trace, elem));
+	}
+
+	struct launch_trace *t = malloc(sizeof *t);
+	if (t == NULL)
+		return NULL;
+	t->sector = inode_get_inumber(inode);
+	t->write_gen = inode_write_gen(inode);
+	t->length = inode_length(inode);
+	t->page_cnt = 0;
+	list_push_front(&traces, &t->elem);
+	return t;
+}
+
+/* Returns the trace of INODE, or NULL. */
+static struct launch_trace *
+trace_find(struct inode *inode)
+{
+	for (struct list_elem *e = list_begin(&traces); e != list_end(&traces); e = list_next(e))
+	{
+		struct launch_trace *t = list_entry(e, struct launch_trace, elem);
+		if (t->sector == inode_get_inumber(inode))
+			return t;
+	}
+	return NULL;
+}
+
+/* Called by exec once EXE is loaded into the current process: loads
+ * the pages its trace lists, or starts recording one.  Only free
+ * frames are used, as for fault-around. */
+void launch_prefetch(struct file *exe)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct inode *inode = file_get_inode(exe);
+	uint64_t *vpn = NULL;
+	size_t page_cnt = 0;
+
+	lock_acquire(&launch_lock);
+	struct launch_trace *t = trace_find(inode);
+	if (t != NULL && t->recorder == NULL && (t->write_gen != inode_write_gen(inode) || t->length != inode_length(inode)))
+	{
+		trace_free(t);
+		t = NULL;
+	}
+	if (t == NULL)
+	{
+		t = trace_create(inode);
+		if (t != NULL)
+		{
+			t->recorder = spt;
+			spt->launch = t;
+		}
+	}
+	else if (t->recorder == NULL && t->page_cnt > 0)
+	{
+		/* The trace may be dropped while the pages load. */
+		list_remove(&t->elem);
+		list_push_front(&traces, &t->elem);
+		vpn = malloc(t->page_cnt * sizeof *vpn);
+		if (vpn != NULL)
+		{
+			page_cnt = t->page_cnt;
+			memcpy(vpn, t->vpn, page_cnt * sizeof *vpn);
+		}
+	}
+	lock_release(&launch_lock);
+
+	if (vpn == NULL)
+		return;
+	size_t loaded = 0;
+	for (size_t i = 0; i < page_cnt; i++)
+		loaded += vm_prefetch((void *)(vpn[i] << PGBITS), PGSIZE, false);
+	free(vpn);
+
+	lock_acquire(&launch_lock);
+	replay_cnt++;
+	prefetch_cnt += loaded;
+	lock_release(&launch_lock);
+}
+
+/* Notes that the process owning SPT faulted in the file page at VA. */
+void launch_record(struct supplemental_page_table *spt, void *va)
+{
+	if (spt->launch == NULL)
+		return;
+
+	lock_acquire(&launch_lock);
+	struct launch_trace *t = spt->launch;
+	uint64_t vpn = pg_no(va);
+	size_t i;
+
+	for (i = 0; i < t->page_cnt; i++)
+		if (t->vpn[i] == vpn)
+			break;
+	if (i == t->page_cnt)
+		t->vpn[t->page_cnt++] = vpn;
+	if (t->page_cnt == LAUNCH_TRACE_PAGES)
+		trace_finish(t);
+	lock_release(&launch_lock);
+}
+
+/* Ends the recording the process owning SPT may still be doing. */
+void launch_stop(struct supplemental_page_table *spt)
+{
+	if (spt->launch == NULL)
+		return;
+
+	lock_acquire(&launch_lock);
+	trace_finish(spt->launch);
+	lock_release(&launch_lock);
+}
+
+void launch_print_stats(void)
+{
+	printf("Launch: %lld traces recorded, %lld execs prefetched %lld pages\n",
+		   record_cnt, replay_cnt, prefetch_cnt);
+}
@@ -0,0 +1,107 @@
+/* rss.c: Working-set estimates of processes.
+ *
+ * wssd wakes every WSS_INTERVAL and walks the whole frame table, one
+ * frame per hold of the frame table lock, asking each private frame
+ * whether it was accessed since the previous pass.  Every frame that
+ * was counts toward its owner's working set for this pass, numbered
+ * by epoch.  An spt keeps the count of the pass in progress and that
+ * of the last pass it was seen in, so nothing has to visit every
+ * process when a pass ends.
+ *
+ * The soft resident-set limit the estimate is compared against lives
+ * with the frame table, in vm.c. */
+
+#include "vm/rss.h"
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* Ticks between two sampling passes, and thus the window a page has
+ * to be touched in to count as part of the working set. */
+#define WSS_INTERVAL TIMER_FREQ
+
+/* Number of the pass in progress.  Starts at 1 so that a fresh spt,
+ * at epoch 0, holds no stale count. */
+static unsigned epoch = 1;
+
+/* Statistics. */
+static long long pass_cnt;	   /* Passes completed. */
+static long long sampled_cnt;  /* Frames looked at. */
+static long long accessed_cnt; /* Of those, frames found accessed. */
+
+static void wssd(void *aux);
+
+void rss_init(void)
+{
+	thread_create("wssd", PRI_DEFAULT, wssd, NULL);
+}
+
+/* Returns the working set of the process owning SPT, in frames, as of
+ * the last pass that finished.  Must hold the frame table lock. */
+size_t rss_working_set(struct supplemental_page_table *spt)
+{
+	if (spt->wss_epoch == epoch)
+		return spt->wss;
+	if (spt->wss_epoch == epoch - 1)
+		return spt->wss_cur;
+	return 0;
+}
+
+/* Counts a frame of the process owning SPT as accessed in this pass. */
+static void
+count_access(struct supplemental_page_table *spt)
+{
+	if (spt->wss_epoch != epoch)
+	{
+		spt->wss = spt->wss_epoch == epoch - 1 ? spt->wss_cur : 0;
+		spt->wss_cur = 0;
+		spt->wss_epoch = epoch;
+	}
+	spt->wss_cur++;
+}
+
+static void
+wssd(void *aux UNUSED)
+{
+	for (;;)
+	{
+		bool wrapped, done = false;
+		size_t visited = 0;
+
+		timer_sleep(WSS_INTERVAL);
+		while (!done)
+		{
+			vm_frame_lock_acquire();
+			struct frame *frame = vm_frame_sample_next(&wrapped);
+			if (frame == NULL)
+				done = true;
+			else
+			{
+				/* Back at the start of the table: this frame is the
+				 * pass's last. */
+				done = wrapped && visited > 0;
+				visited++;
+				sampled_cnt++;
+				/* Shared text counts toward no one's working set. */
+				if (frame->page != NULL && vm_frame_sample_accessed(frame))
+				{
+					accessed_cnt++;
+					count_access(&frame->page->owner->spt);
+				}
+			}
+			if (done)
+			{
+				epoch++;
+				pass_cnt++;
+			}
+			vm_frame_lock_release();
+		}
+	}
+}
+
+void rss_print_stats(void)
+{
+	printf("WSS: %lld passes, %lld of %lld sampled frames accessed\n",
+		   pass_cnt, accessed_cnt, sampled_cnt);
+}
@@ -3,3 +3,10 @@ vm_SRC += vm/uninit.c     # Uninitialized page
 vm_SRC += vm/anon.c       # Anonymous page
 vm_SRC += vm/file.c       # File mapped page
 vm_SRC += vm/inspect.c    # Testing utility
+vm_SRC += vm/zswap.c      # Compressed swap cache
+vm_SRC += vm/ksm.c        # Same-page merging
+vm_SRC += vm/text.c       # Shared executable text
+vm_SRC += vm/kswapd.c     # Background page-out
+vm_SRC += vm/faultstat.c  # Fault latency statistics
+vm_SRC += vm/launch.c     # Startup page prefetch
+vm_SRC += vm/rss.c        # Resident-set limits and working sets
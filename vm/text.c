@@ -0,0 +1,209 @@
+/* text.c: Shared frames for read-only executable segments.
+ *
+ * The first process to fault on a page of a read-only PT_LOAD segment
+ * reads it into a frame that is entered here under (inode, offset,
+ * bytes read).  Every later fault on the same page of the same binary,
+ * in any process, maps that frame read-only instead of reading the
+ * disk again.  The frame's share_cnt counts the pages mapping it.
+ *
+ * When the last of them goes away the frame is kept on an idle list,
+ * so running the binary again still costs no disk reads.  Idle frames
+ * are the first thing vm_get_frame() reclaims under memory pressure,
+ * and at most TEXT_IDLE_MAX of them are kept.  An idle entry whose
+ * inode was written since it was filled is dropped on lookup.
+ *
+ * Cached frames sit in the frame table, owned by no page, so the clock
+ * also evicts text that is mapped but cold: vm.c unmaps every page in
+ * the frame's rmap, which loads lazily again, and then drops the entry
+ * with text_cache_evict(). */
+
+#include "vm/text.h"
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "filesys/inode.h"
+#include "vm/vm.h"
+
+/* Idle frames kept for executables nobody runs right now. */
+#define TEXT_IDLE_MAX 64
+
+struct text_entry
+{
+	struct hash_elem elem;		/* Element in entries. */
+	struct list_elem idle_elem; /* Element in idle while unmapped. */
+	struct inode *inode;		/* Reference held by the entry. */
+	off_t ofs;					/* Offset of the page in the file. */
+	uint32_t read_bytes;		/* Bytes read, the rest is zeros. */
+	unsigned write_gen;			/* inode_write_gen() when filled. */
+	struct frame *frame;
+};
+
+static struct hash entries;
+static struct list idle; /* Unmapped entries, oldest first. */
+
+/* Statistics. */
+static long long hit_cnt;	  /* Faults served without reading the disk. */
+static long long fill_cnt;	  /* Pages read from the disk. */
+static long long reclaim_cnt; /* Idle frames given back. */
+
+static uint64_t
+entry_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+	const struct text_entry *t = hash_entry(e, struct text_entry, elem);
+	uint64_t key[3] = {(uint64_t)t->inode, t->ofs, t->read_bytes};
+	return hash_bytes(key, sizeof key);
+}
+
+static bool
+entry_less(const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED)
+{
+	const struct text_entry *a = hash_entry(a_, struct text_entry, elem);
+	const struct text_entry *b = hash_entry(b_, struct text_entry, elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+void text_cache_init(void)
+{
+	hash_init(&entries, entry_hash, entry_less, NULL);
+	list_init(&idle);
+}
+
+/* Unlinks the idle entry T and returns its frame, detached from the
+ * frame table too.  This may close the last reference to the inode
+ * under the frame table lock: inode_close() takes only the open-inode
+ * table and free map locks, which never wait for the frame table, and
+ * does no I/O. */
+static struct frame *
+entry_drop(struct text_entry *t)
+{
+	struct frame *frame = t->frame;
+
+	vm_frame_detach(frame);
+	hash_delete(&entries, &t->elem);
+	list_remove(&t->idle_elem);
+	inode_close(t->inode);
+	free(t);
+	frame->text = NULL;
+	return frame;
+}
+
+/* Frees FRAME and its page. */
+static void
+frame_release(struct frame *frame)
+{
+	palloc_free_page(frame->kva);
+	free(frame);
+}
+
+/* Returns the cached frame for the page and takes a reference to it,
+ * or NULL if the page is not cached. */
+struct frame *
+text_cache_lookup(struct inode *inode, off_t ofs, uint32_t read_bytes)
+{
+	struct text_entry key;
+	key.inode = inode;
+	key.ofs = ofs;
+	key.read_bytes = read_bytes;
+
+	struct hash_elem *e = hash_find(&entries, &key.elem);
+	if (e == NULL)
+		return NULL;
+
+	struct text_entry *t = hash_entry(e, struct text_entry, elem);
+	if (t->frame->share_cnt == 0)
+	{
+		/* Mapped entries are safe: the binary is write-denied while
+		 * it runs.  An idle one may have been rewritten since. */
+		if (t->write_gen != inode_write_gen(inode))
+		{
+			frame_release(entry_drop(t));
+			return NULL;
+		}
+		list_remove(&t->idle_elem);
+	}
+	t->frame->share_cnt++;
+	hit_cnt++;
+	return t->frame;
+}
+
+/* Enters FRAME, just filled from INODE, into the cache with one
+ * reference for the caller.  The caller adds FRAME to the frame
+ * table.  Returns false if out of memory. */
+bool text_cache_insert(struct frame *frame, struct inode *inode, off_t ofs,
+					   uint32_t read_bytes)
+{
+	struct text_entry *t = malloc(sizeof *t);
+	if (t == NULL)
+		return false;
+
+	t->inode = inode_reopen(inode);
+	t->ofs = ofs;
+	t->read_bytes = read_bytes;
+	t->write_gen = inode_write_gen(inode);
+	t->frame = frame;
+	hash_insert(&entries, &t->elem);
+
+	frame->text = t;
+	frame->share_cnt = 1;
+	fill_cnt++;
+	return true;
+}
+
+/* Drops one page's reference to the text FRAME.  The last one moves
+ * it to the idle list. */
+void text_cache_put(struct frame *frame)
+{
+	ASSERT(frame->text != NULL && frame->share_cnt > 0);
+
+	if (--frame->share_cnt > 0)
+		return;
+	list_push_back(&idle, &frame->text->idle_elem);
+	if (list_size(&idle) > TEXT_IDLE_MAX)
+	{
+		struct text_entry *oldest = list_entry(list_front(&idle), struct text_entry, idle_elem);
+		frame_release(entry_drop(oldest));
+		reclaim_cnt++;
+	}
+}
+
+/* Stores where the text FRAME was read from in *OFS and *READ_BYTES. */
+void text_cache_source(struct frame *frame, off_t *ofs, uint32_t *read_bytes)
+{
+	ASSERT(frame->text != NULL);
+	*ofs = frame->text->ofs;
+	*read_bytes = frame->text->read_bytes;
+}
+
+/* Takes the text FRAME, which no page maps any more, out of the cache
+ * for reuse and returns it. */
+struct frame *
+text_cache_evict(struct frame *frame)
+{
+	ASSERT(frame->text != NULL && frame->share_cnt == 0);
+	reclaim_cnt++;
+	return entry_drop(frame->text);
+}
+
+/* Takes the oldest idle frame out of the cache for reuse.  Returns
+ * NULL if there is none. */
+struct frame *
+text_cache_reclaim(void)
+{
+	if (list_empty(&idle))
+		return NULL;
+	reclaim_cnt++;
+	return entry_drop(list_entry(list_front(&idle), struct text_entry, idle_elem));
+}
+
+void text_cache_print_stats(void)
+{
+	printf("Text cache: %lld pages read, %lld faults shared, %lld reclaimed\n",
+		   fill_cnt, hit_cnt, reclaim_cnt);
+}
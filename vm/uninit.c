@@ -10,6 +10,9 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
 
 static bool uninit_initialize(struct page *page, void *kva);
 static void uninit_destroy(struct page *page);
@@ -54,8 +57,15 @@ uninit_initialize(struct page *page, void *kva)
 	void *aux = uninit->aux;			 // lazy_load_arg
 
 	/* TODO: You may need to fix this function. */
-	return uninit->page_initializer(page, uninit->type, kva) &&
-		   (init ? init(page, aux) : true);
+	if (!uninit->page_initializer(page, uninit->type, kva))
+		return false;
+	if (init == NULL)
+	{
+		// 초기화 함수가 없는 페이지는 0으로 채워진 채 시작한다.
+		memset(kva, 0, PGSIZE);
+		return true;
+	}
+	return init(page, aux);
 }
 
 /* Free the resources hold by uninit_page. Although most of pages are transmuted
@@ -74,4 +84,11 @@ uninit_destroy(struct page *page)
 	 * TODO: If you don't have anything to do, just return. */
 	// page struct에 의해 유지되고 있던 리소스를 해제합니다.
 	// 페이지의 vm 유형을 확인하고 그에 맞게 처리하는 것이 좋습니다.
+	if (uninit->aux == NULL)
+		return;
+
+	/* mmap 페이지는 자기 파일 핸들을 가지고 있다. */
+	if (VM_TYPE(uninit->type) == VM_FILE)
+		file_close(((struct file_page *)uninit->aux)->meta.file);
+	free(uninit->aux);
 }
@@ -1,10 +1,60 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
+#include <string.h>
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "intrinsic.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/ksm.h"
+#include "vm/kswapd.h"
+#include "vm/launch.h"
+#include "vm/rss.h"
+#include "vm/text.h"
+#include "vm/zswap.h"
+
+/* Largest number of neighbours mapped by one fault-around. */
+#define FAULT_AROUND_MAX 32
+
+/* 4 kB pages in a 2 MB page. */
+#define HPGCNT (HPGSIZE / PGSIZE)
+
+/* Every user frame that currently backs a page, in clock order. */
+static struct list frame_table;
+static struct lock frame_lock;
+static struct list_elem *clock_hand;
+static struct list_elem *scan_hand;  /* Position of background scanners. */
+static struct list_elem *flush_hand; /* Position of the file flusher. */
+static struct list_elem *sample_hand; /* Position of the working-set sampler. */
+
+/* Processes holding more private frames than their soft limit. */
+static int over_limit_cnt;
+
+/* Pages mapped ahead of the faulting address. */
+static long long fault_around_cnt;
+/* Pages loaded by madvise(MADV_WILLNEED) or MAP_POPULATE. */
+static long long prefetch_cnt;
+/* Pages dropped by madvise(MADV_DONTNEED). */
+static long long dontneed_cnt;
+/* Frames a fault had to evict itself because none were free. */
+static long long direct_reclaim_cnt;
+/* Victims taken from processes over their resident-set limit. */
+static long long over_limit_evict_cnt;
+/* 2 MB regions mapped by a single fault, and regions that qualified
+ * but found no free aligned run. */
+static long long thp_map_cnt;
+static long long thp_fallback_cnt;
+/* Write faults that gave a page its own copy of a shared frame. */
+static long long cow_cnt;
+
+/* A read-only frame of zeros, mapped by read faults on anonymous pages
+ * that were never written.  It holds one reference of its own, so it
+ * is always shared and never freed. */
+static struct frame zero_frame;
+static long long zero_map_cnt;	/* Read faults served by zero_frame. */
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -18,6 +68,45 @@ void vm_init(void)
 	register_inspect_intr();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
+	list_init(&frame_table);
+	lock_init(&frame_lock);
+	clock_hand = NULL;
+	scan_hand = NULL;
+	flush_hand = NULL;
+	sample_hand = NULL;
+	over_limit_cnt = 0;
+	zero_frame.kva = palloc_get_page(PAL_ZERO | PAL_ASSERT);
+	zero_frame.share_cnt = 1;
+	list_init(&zero_frame.rmap);
+	fault_stat_init();
+	text_cache_init();
+	launch_init();
+	ksm_init();
+	kswapd_init();
+	rss_init();
+}
+
+/* Prints VM statistics at shutdown. */
+void vm_print_stats(void)
+{
+	printf("Fault-around: %lld pages mapped ahead\n", fault_around_cnt);
+	printf("Advice: %lld pages prefetched, %lld pages dropped\n",
+		   prefetch_cnt, dontneed_cnt);
+	printf("THP: %lld 2 MB pages mapped, %lld fallbacks to 4 kB\n",
+		   thp_map_cnt, thp_fallback_cnt);
+	printf("COW: %lld shared pages copied on write\n", cow_cnt);
+	printf("Zero page: %lld read faults served, %lld frames still avoided\n",
+		   zero_map_cnt, (long long)zero_frame.share_cnt - 1);
+	printf("Direct reclaim: %lld frames evicted by faults\n", direct_reclaim_cnt);
+	printf("RSS limit: %lld frames evicted from processes over their limit\n",
+		   over_limit_evict_cnt);
+	rss_print_stats();
+	kswapd_print_stats();
+	file_print_stats();
+	text_cache_print_stats();
+	launch_print_stats();
+	ksm_print_stats();
+	zswap_print_stats();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -39,7 +128,20 @@ page_get_type(struct page *page)
 /* Helpers */
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
+static bool vm_install_frame(struct page *page, struct frame *frame);
 static struct frame *vm_evict_frame(void);
+static struct file_meta_data *page_file_meta(struct page *page);
+static bool page_is_pristine(struct page *page);
+static bool vm_map_zero(struct page *page);
+static bool vm_map_huge(struct supplemental_page_table *spt, struct page *page);
+static bool page_is_shared_text(struct page *page);
+static bool vm_map_text(struct page *page, bool may_evict);
+static bool vm_load_ahead(struct page *page, bool may_evict);
+static void frame_get_shared(struct frame *frame);
+static void frame_put_shared(struct frame *frame);
+static bool spt_copy_page(struct page *src, void *bounce);
+static void vm_fault_around(struct supplemental_page_table *spt, struct page *page,
+							struct inode *inode, off_t ofs);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -72,6 +174,8 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 
 		uninit_new(p, upage, init, type, aux, page_initializer);
 		p->writable = writable;
+		p->owner = thread_current();
+		p->advice = VM_ADV_NORMAL;
 
 		/* TODO: Insert the page into the spt. */
 		return spt_insert_page(spt, p);
@@ -80,21 +184,37 @@ err:
 	return false;
 }
 
+/* The spt is a radix tree indexed exactly like the hardware page
+ * table: each level uses the same 9 bits of the address as the
+ * matching pml4 level, and the last level holds struct page pointers.
+ * Interior nodes are zeroed kernel pages allocated on insert. */
+#define SPT_LEVELS 4
+#define SPT_FANOUT 512
+static const unsigned spt_shift[SPT_LEVELS] = {PML4SHIFT, PDPESHIFT, PDXSHIFT, PTXSHIFT};
+#define SPT_INDEX(va, level) (((uint64_t)(va) >> spt_shift[level]) & (SPT_FANOUT - 1))
+
+/* Returns the leaf slot for VA, or NULL if the path to it does not
+ * exist.  If CREATE, missing nodes are allocated instead. */
+static struct page **
+spt_walk(struct supplemental_page_table *spt, void *va, bool create)
+{
+	void **slot = &spt->root;
+	for (int level = 0; level < SPT_LEVELS; level++)
+	{
+		if (*slot == NULL && (!create || (*slot = palloc_get_page(PAL_ZERO)) == NULL))
+			return NULL;
+		slot = &((void **)*slot)[SPT_INDEX(va, level)];
+	}
+	return (struct page **)slot;
+}
+
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
 spt_find_page(struct supplemental_page_table *spt UNUSED, void *va UNUSED)
 {
-	struct page *page = NULL;
-
 	/* TODO: Fill this function. */
-	page = (struct page *)malloc(sizeof(struct page));
-	struct hash_elem *e;
-
-	page->va = pg_round_down(va); 
-	e = hash_find(&spt->spt_hash, &page->hash_elem);
-	free(page);
-
-	return e != NULL ? hash_entry(e, struct page, hash_elem) : NULL;
+	struct page **slot = spt_walk(spt, pg_round_down(va), false);
+	return slot != NULL ? *slot : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
@@ -102,15 +222,287 @@ bool spt_insert_page(struct supplemental_page_table *spt UNUSED,
 					 struct page *page UNUSED)
 {
 	/* TODO: Fill this function. */
-	struct hash_elem *e = hash_insert(&spt->spt_hash, &page->hash_elem);
-	return (e == NULL);}
+	struct page **slot = spt_walk(spt, page->va, true);
+	if (slot == NULL || *slot != NULL)
+		return false;
+	*slot = page;
+	return true;
+}
 
+/* Removes PAGE from SPT and frees it.  Emptied nodes are kept until
+ * the table is killed. */
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
 {
+	struct page **slot = spt_walk(spt, page->va, false);
+	ASSERT(slot != NULL && *slot == page);
+	*slot = NULL;
 	vm_dealloc_page(page);
+}
+
+static bool
+spt_node_for_each(void **node, int level, spt_action_func *action, void *aux)
+{
+	for (size_t i = 0; i < SPT_FANOUT; i++)
+	{
+		if (node[i] == NULL)
+			continue;
+		if (level == SPT_LEVELS - 1 ? !action(node[i], aux)
+									: !spt_node_for_each(node[i], level + 1, action, aux))
+			return false;
+	}
 	return true;
 }
 
+/* Calls ACTION on every page of SPT in ascending address order,
+ * stopping early if it returns false.  ACTION may remove the page it
+ * is given.  Returns false if any ACTION did. */
+bool spt_for_each(struct supplemental_page_table *spt, spt_action_func *action, void *aux)
+{
+	return spt->root == NULL || spt_node_for_each(spt->root, 0, action, aux);
+}
+
+/* Frees every page under NODE, then NODE itself. */
+static void
+spt_node_destroy(void **node, int level)
+{
+	for (size_t i = 0; i < SPT_FANOUT; i++)
+	{
+		if (node[i] == NULL)
+			continue;
+		if (level == SPT_LEVELS - 1)
+			vm_dealloc_page(node[i]);
+		else
+			spt_node_destroy(node[i], level + 1);
+	}
+	palloc_free_page(node);
+}
+
+/* Advances *HAND one frame, wrapping around the table, and returns
+ * the frame it passed.  *WRAPPED tells whether it started over. */
+static struct frame *
+frame_cursor_next(struct list_elem **hand, bool *wrapped)
+{
+	*wrapped = *hand == NULL || *hand == list_end(&frame_table);
+	if (*wrapped)
+		*hand = list_begin(&frame_table);
+	struct frame *frame = list_entry(*hand, struct frame, frame_elem);
+	*hand = list_next(*hand);
+	return frame;
+}
+
+/* Advances the clock hand one frame, wrapping around the table. */
+static struct frame *
+clock_next(void)
+{
+	bool wrapped;
+	return frame_cursor_next(&clock_hand, &wrapped);
+}
+
+void vm_frame_lock_acquire(void)
+{
+	lock_acquire(&frame_lock);
+}
+
+void vm_frame_lock_release(void)
+{
+	lock_release(&frame_lock);
+}
+
+/* Returns the next frame for a background scanner such as ksmd, or
+ * NULL if the table is empty.  Must hold the frame table lock. */
+struct frame *
+vm_frame_scan_next(bool *wrapped)
+{
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	if (list_empty(&frame_table))
+		return NULL;
+	return frame_cursor_next(&scan_hand, wrapped);
+}
+
+/* Same as vm_frame_scan_next(), with the file flusher's own cursor. */
+struct frame *
+vm_frame_flush_next(bool *wrapped)
+{
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	if (list_empty(&frame_table))
+		return NULL;
+	return frame_cursor_next(&flush_hand, wrapped);
+}
+
+/* Same as vm_frame_scan_next(), with the working-set sampler's own
+ * cursor. */
+struct frame *
+vm_frame_sample_next(bool *wrapped)
+{
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	if (list_empty(&frame_table))
+		return NULL;
+	return frame_cursor_next(&sample_hand, wrapped);
+}
+
+/* Returns true if process T holds more private frames than its soft
+ * limit allows. */
+static bool
+rss_over_limit(struct thread *t)
+{
+	return t->rss_limit != 0 && t->spt.rss > t->rss_limit;
+}
+
+/* Adds DELTA private frames to the resident set of process T.  Must
+ * hold the frame table lock. */
+static void
+rss_charge(struct thread *t, int delta)
+{
+	bool was_over = rss_over_limit(t);
+
+	t->spt.rss += delta;
+	if (rss_over_limit(t) != was_over)
+		over_limit_cnt += was_over ? -1 : 1;
+}
+
+/* Sets the soft limit on the private frames of process T to LIMIT, 0
+ * for none.  Going over it costs nothing until memory runs short;
+ * then eviction takes the frames of processes over their limit
+ * first. */
+void vm_set_rss_limit(struct thread *t, size_t limit)
+{
+	lock_acquire(&frame_lock);
+	bool was_over = rss_over_limit(t);
+	t->rss_limit = limit;
+	if (rss_over_limit(t) != was_over)
+		over_limit_cnt += was_over ? -1 : 1;
+	lock_release(&frame_lock);
+}
+
+/* Links FRAME into the frame table: a private frame, charged to the
+ * owner of FRAME->page, or a text frame, which no one is charged for.
+ * Must hold the frame table lock. */
+static void
+frame_table_add(struct frame *frame)
+{
+	list_push_back(&frame_table, &frame->frame_elem);
+	if (frame->page != NULL)
+		rss_charge(frame->page->owner, 1);
+}
+
+/* Unlinks FRAME, private or shared, from the frame table, keeping every
+ * cursor valid.  Must hold the frame table lock. */
+void vm_frame_detach(struct frame *frame)
+{
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	if (clock_hand == &frame->frame_elem)
+		clock_hand = list_next(clock_hand);
+	if (scan_hand == &frame->frame_elem)
+		scan_hand = list_next(scan_hand);
+	if (flush_hand == &frame->frame_elem)
+		flush_hand = list_next(flush_hand);
+	if (sample_hand == &frame->frame_elem)
+		sample_hand = list_next(sample_hand);
+	list_remove(&frame->frame_elem);
+	if (frame->page != NULL)
+		rss_charge(frame->page->owner, -1);
+	ksm_forget(frame);
+}
+
+/* Turns the private FRAME into a shared one, which stays in the frame
+ * table for the clock but is charged to no one.  Must hold the frame
+ * table lock. */
+void vm_frame_share(struct frame *frame)
+{
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	rss_charge(frame->page->owner, -1);
+	ksm_forget(frame);
+	frame->page = NULL;
+	frame->share_cnt = 1;
+}
+
+/* Points PAGE at FRAME and enters it into FRAME's rmap.  Must hold
+ * the frame table lock once FRAME can be seen by others. */
+void vm_frame_link(struct frame *frame, struct page *page)
+{
+	page->frame = frame;
+	list_push_back(&frame->rmap, &page->rmap_elem);
+}
+
+/* Takes PAGE, which maps FRAME, out of FRAME's rmap and unmaps it from
+ * its owner's page table.  Same locking as vm_frame_link(). */
+void vm_frame_unlink(struct frame *frame, struct page *page)
+{
+	ASSERT(page->frame == frame);
+	if (page->owner->pml4 != NULL)
+		pml4_clear_page(page->owner->pml4, page->va);
+	list_remove(&page->rmap_elem);
+	page->frame = NULL;
+}
+
+/* Clears the accessed bits of every page mapping FRAME and returns
+ * true if any was set. */
+static bool
+frame_harvest_accessed(struct frame *frame)
+{
+	bool accessed = false;
+
+	for (struct list_elem *e = list_begin(&frame->rmap); e != list_end(&frame->rmap); e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, rmap_elem);
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (pml4 != NULL && pml4_is_accessed(pml4, page->va))
+		{
+			pml4_set_accessed(pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* The clock and the working-set sampler both clear the accessed bits
+ * they read.  Each one leaves what it saw to the other in a flag of
+ * the frame, so neither misses a reference. */
+
+/* Returns true if any page mapping FRAME was accessed since the
+ * clock last looked at it.  Must hold the frame table lock. */
+bool vm_frame_test_accessed(struct frame *frame)
+{
+	bool accessed = frame_harvest_accessed(frame);
+
+	if (accessed)
+		frame->sample_referenced = true;
+	accessed |= frame->clock_referenced;
+	frame->clock_referenced = false;
+	return accessed;
+}
+
+/* Returns true if any page mapping FRAME was accessed since the
+ * working-set sampler last looked at it.  Must hold the frame table
+ * lock. */
+bool vm_frame_sample_accessed(struct frame *frame)
+{
+	bool accessed = frame_harvest_accessed(frame);
+
+	if (accessed)
+		frame->clock_referenced = true;
+	accessed |= frame->sample_referenced;
+	frame->sample_referenced = false;
+	return accessed;
+}
+
+/* Returns true if eviction has to pass FRAME over for now: it holds
+ * a mapped file page that its owner dirtied, which only
+ * file_write_back_all() writes back, without the frame table lock, or
+ * it is a shared frame, text or merged, with a reference whose page
+ * is not mapped yet. */
+static bool
+frame_is_busy(struct frame *frame)
+{
+	struct page *page = frame->page;
+
+	if (page == NULL)
+		return frame->share_cnt != list_size(&frame->rmap);
+	uint64_t *pml4 = page->owner->pml4;
+	return page_get_type(page) == VM_FILE && pml4 != NULL && pml4_is_dirty(pml4, page->va);
+}
+
 /* Get the struct frame, that will be evicted. */
 static struct frame *
 vm_get_victim(void)
@@ -118,9 +510,106 @@ vm_get_victim(void)
 	struct frame *victim = NULL;
 	/* TODO: The policy for eviction is up to you. */
 
+	/* Second-chance clock: a frame that any of its mappings accessed
+	 * gets the bits cleared and is skipped once.  Two sweeps always
+	 * find a victim unless every frame is busy.  While some process
+	 * is over its resident-set limit, a first sweep looks at that
+	 * process's private frames only. */
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	if (over_limit_cnt > 0)
+	{
+		for (size_t i = 0; i < list_size(&frame_table); i++)
+		{
+			struct frame *frame = clock_next();
+
+			if (frame->page != NULL && rss_over_limit(frame->page->owner) && !vm_frame_test_accessed(frame) && !frame_is_busy(frame))
+			{
+				over_limit_evict_cnt++;
+				return frame;
+			}
+		}
+	}
+	for (size_t i = 0; i < 2 * list_size(&frame_table); i++)
+	{
+		struct frame *frame = clock_next();
+
+		if (!vm_frame_test_accessed(frame) && !frame_is_busy(frame))
+		{
+			victim = frame;
+			break;
+		}
+	}
 	return victim;
 }
 
+/* Write-protects every page mapping FRAME, or gives each back its own
+ * permission if WRITABLE.  Must hold the frame table lock. */
+static void
+frame_set_writable(struct frame *frame, bool writable)
+{
+	for (struct list_elem *e = list_begin(&frame->rmap); e != list_end(&frame->rmap); e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, rmap_elem);
+
+		if (page->owner->pml4 != NULL)
+			pml4_set_writable(page->owner->pml4, page->va, writable && page->writable);
+	}
+}
+
+/* Loads PAGE, a text page whose frame was evicted, from its owner's
+ * executable into a frame of its own.  Only a fork that copies PAGE
+ * does that: a fault maps it from the text cache again. */
+static bool
+text_page_load(struct page *page, void *aux)
+{
+	struct file_meta_data *meta = aux;
+	off_t read_bytes = meta->page_read_bytes;
+	bool success = file_read_at(meta->file, page->frame->kva, read_bytes, meta->ofs) == read_bytes;
+
+	memset(page->frame->kva + read_bytes, 0, meta->page_zero_bytes);
+	free(meta);
+	return success;
+}
+
+/* Evicts the text FRAME.  Every page mapping it is unmapped and goes
+ * back to loading lazily from its owner's executable, so its next
+ * fault finds the page missing from the text cache and reads it
+ * again.  Returns false if out of memory; the pages done by then just
+ * fault the frame back.  Must hold the frame table lock. */
+static bool
+vm_evict_text(struct frame *frame)
+{
+	off_t ofs;
+	uint32_t read_bytes;
+
+	text_cache_source(frame, &ofs, &read_bytes);
+	while (!list_empty(&frame->rmap))
+	{
+		struct page *page = list_entry(list_front(&frame->rmap), struct page, rmap_elem);
+		struct file_meta_data *meta = malloc(sizeof *meta);
+		if (meta == NULL)
+			return false;
+		meta->file = page->owner->running;
+		meta->ofs = ofs;
+		meta->page_read_bytes = read_bytes;
+		meta->page_zero_bytes = PGSIZE - read_bytes;
+
+		vm_frame_unlink(frame, page);
+		text_cache_put(frame);
+
+		/* uninit_new() clears the fields it does not know about. */
+		bool writable = page->writable;
+		struct thread *owner = page->owner;
+		uint8_t advice = page->advice;
+		uninit_new(page, page->va, text_page_load, VM_ANON | VM_MARKER_1, meta, anon_initializer);
+		page->writable = writable;
+		page->owner = owner;
+		page->advice = advice;
+	}
+	text_cache_evict(frame);
+	return true;
+}
+
 /* Evict one page and return the corresponding frame.
  * Return NULL on error.*/
 static struct frame *
@@ -128,10 +617,156 @@ vm_evict_frame(void)
 {
 	struct frame *victim UNUSED = vm_get_victim();
 	/* TODO: swap out the victim and return the evicted frame. */
+	if (victim == NULL)
+		return NULL;
+	if (victim->text != NULL)
+		return vm_evict_text(victim) ? victim : NULL;
+	if (victim->page == NULL)
+		return ksm_evict(victim) ? victim : NULL;
+
+	/* Write-protect every mapping before the copy, so no owner can
+	 * store into the frame while swap_out() waits on the disk.  A write
+	 * fault meanwhile blocks on the frame table lock and then finds the
+	 * page evicted. */
+	struct page *page = victim->page;
+	frame_set_writable(victim, false);
+	if (!swap_out(page))
+	{
+		frame_set_writable(victim, true);
+		return NULL;
+	}
+
+	/* Unmap every mapping before unlinking so their owners fault the
+	 * page back in. */
+	while (!list_empty(&victim->rmap))
+		vm_frame_unlink(victim, list_entry(list_front(&victim->rmap), struct page, rmap_elem));
+	vm_frame_detach(victim);
+	victim->page = NULL;
+
+	return victim;
+}
+
+/* Takes another reference to the shared FRAME for a new page. */
+static void
+frame_get_shared(struct frame *frame)
+{
+	ASSERT(frame->share_cnt > 0);
+	if (frame == &zero_frame || frame->text != NULL)
+		frame->share_cnt++;
+	else
+		ksm_get(frame);
+}
 
+/* Drops one page's reference to the shared FRAME. */
+static void
+frame_put_shared(struct frame *frame)
+{
+	if (frame == &zero_frame)
+		zero_frame.share_cnt--;
+	else if (frame->text != NULL)
+		text_cache_put(frame);
+	else
+		ksm_put(frame);
+}
+
+/* Releases the frame backing PAGE, if any, and unmaps it from the
+ * owner's page table.  The page itself stays in the spt. */
+void vm_free_frame(struct page *page)
+{
+	lock_acquire(&frame_lock);
+	struct frame *frame = page->frame;
+	if (frame != NULL)
+	{
+		vm_frame_unlink(frame, page);
+		if (frame->share_cnt > 0)
+			frame_put_shared(frame);
+		else
+		{
+			vm_frame_detach(frame);
+			palloc_free_page(frame->kva);
+			free(frame);
+		}
+	}
+	lock_release(&frame_lock);
+}
+
+/* Clears the bookkeeping of a new or recycled FRAME. */
+static void
+frame_reset(struct frame *frame)
+{
+	frame->page = NULL;
+	frame->share_cnt = 0;
+	frame->checksum = 0;
+	frame->ksm_candidate = false;
+	frame->text = NULL;
+	frame->clock_referenced = false;
+	frame->sample_referenced = false;
+	list_init(&frame->rmap);
+}
+
+/* Takes a user frame from an idle text page or, if MAY_EVICT, from
+ * the clock's victim, adding evictions to *EVICT_CNT if not NULL.
+ * Dirty file pages cannot be evicted before they are written back, so
+ * if only those are left it writes them back and tries once more. */
+static struct frame *
+frame_reclaim(bool may_evict, long long *evict_cnt)
+{
+	for (int pass = 0; pass < 2; pass++)
+	{
+		lock_acquire(&frame_lock);
+		struct frame *frame = text_cache_reclaim();
+		if (frame == NULL && may_evict)
+		{
+			frame = vm_evict_frame();
+			if (frame != NULL && evict_cnt != NULL)
+				(*evict_cnt)++;
+		}
+		lock_release(&frame_lock);
+		if (frame != NULL || !may_evict || file_write_back_all() == 0)
+			return frame;
+	}
 	return NULL;
 }
 
+/* Returns a frame with a free user page, or NULL if there is none.
+ * Idle cached text is reused before anything is evicted, and eviction
+ * happens only if MAY_EVICT. */
+static struct frame *
+frame_alloc(bool may_evict)
+{
+	struct frame *frame = malloc(sizeof(struct frame));
+	if (frame == NULL)
+		return NULL;
+
+	frame->kva = palloc_get_page(PAL_USER);
+	if (palloc_user_free_cnt() < kswapd_low_wmark)
+		kswapd_wake();
+	if (frame->kva == NULL)
+	{
+		/* kswapd fell behind: reclaim on the faulting thread. */
+		free(frame);
+		frame = frame_reclaim(may_evict, &direct_reclaim_cnt);
+		if (frame == NULL)
+			return NULL;
+	}
+	frame_reset(frame);
+	return frame;
+}
+
+/* Gives one user frame back to the pool for kswapd: an idle text
+ * frame if there is one, else the clock's victim.  Returns false if
+ * nothing could be freed. */
+bool vm_reclaim_frame(void)
+{
+	struct frame *frame = frame_reclaim(true, NULL);
+	if (frame == NULL)
+		return false;
+
+	palloc_free_page(frame->kva);
+	free(frame);
+	return true;
+}
+
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
@@ -139,18 +774,10 @@ vm_evict_frame(void)
 static struct frame *
 vm_get_frame(void)
 {
-    struct frame *frame = malloc(sizeof(struct frame)); // 가상 메모리에 할당 -> 페이지
-    if (frame == NULL) {
-        PANIC("Failed to allocate memory for frame.");
-    }
-
-    frame->kva = palloc_get_page(PAL_USER); // 물리 메모리에 할당 -> 프레임
-    if (frame->kva == NULL) {
-        // Handle page eviction if no page is available.
-        PANIC("Need to implement page eviction.");
-    }
-
-	frame->page = NULL;
+    // 빈 프레임이 없으면 쉬고 있는 코드 프레임을 거두거나 희생 프레임을 쫓아낸다.
+    struct frame *frame = frame_alloc(true);
+    if (frame == NULL)
+        PANIC("Out of user frames and nothing to evict.");
 
     ASSERT(frame != NULL);
     ASSERT(frame->page == NULL);
@@ -165,17 +792,95 @@ vm_stack_growth(void *addr UNUSED)
 }
 
 /* Handle the fault on write_protected page */
+// 쓰기 가능한 페이지가 공유(KSM) 프레임에 매핑되어 있으면 복사본을 만들어 준다.
 static bool
-vm_handle_wp(struct page *page UNUSED)
+vm_handle_wp(struct page *page UNUSED, enum fault_class *class)
 {
+	if (!page->writable)
+		return false;
+
+	/* Get the copy's frame without the lock: it may evict.  Everything
+	 * about the page is read again once the lock is back. */
+	struct frame *frame, *copy = NULL;
+	lock_acquire(&frame_lock);
+	for (;;)
+	{
+		frame = page->frame;
+		if (frame == NULL || frame->share_cnt <= 1 || copy != NULL)
+			break;
+		lock_release(&frame_lock);
+		copy = vm_get_frame();
+		lock_acquire(&frame_lock);
+	}
+
+	if (frame == NULL)
+	{
+		/* Evicted since the fault: returning retries the access,
+		 * which faults the page back in. */
+		*class = FAULT_WRITE_PROTECT;
+	}
+	else if (frame->share_cnt > 1)
+	{
+		*class = FAULT_COW;
+		memcpy(copy->kva, frame->kva, PGSIZE);
+		vm_frame_unlink(frame, page);
+		frame_put_shared(frame);
+		frame = copy;
+		copy = NULL;
+		frame->page = page;
+		vm_frame_link(frame, page);
+		frame_table_add(frame);
+		cow_cnt++;
+	}
+	else if (frame->share_cnt == 1)
+	{
+		/* Everyone else already let go: take the frame back.  It
+		 * never left the frame table. */
+		*class = FAULT_COW;
+		ksm_unshare(frame);
+		frame->page = page;
+		rss_charge(page->owner, 1);
+	}
+	else
+	{
+		/* ksmd or eviction write-protected the page but kept it. */
+		*class = FAULT_WRITE_PROTECT;
+	}
+	if (frame != NULL)
+		pml4_set_page(page->owner->pml4, page->va, frame->kva, true);
+	lock_release(&frame_lock);
+
+	if (copy != NULL)
+	{
+		palloc_free_page(copy->kva);
+		free(copy);
+	}
+	return true;
 }
 
-/* Return true on success */
-bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
-						 bool user UNUSED, bool write UNUSED, bool not_present UNUSED)
+/* Returns what a not-present fault on PAGE is about to do. */
+static enum fault_class
+classify_fault(struct page *page)
+{
+	if (VM_TYPE(page->operations->type) != VM_UNINIT)
+		return FAULT_SWAP_IN;
+	if (page->uninit.type & VM_MARKER_0)
+		return FAULT_STACK;
+	if (VM_TYPE(page->uninit.type) == VM_FILE)
+		return FAULT_LAZY_FILE;
+	struct file_meta_data *meta = page_file_meta(page);
+	return meta != NULL && meta->page_read_bytes > 0 ? FAULT_LAZY_FILE : FAULT_LAZY_ANON;
+}
+
+/* Resolves the fault at ADDR, storing its class in *CLASS.  Returns
+ * false if it is a bad access. */
+static bool
+vm_handle_fault(void *addr, bool write, bool not_present, enum fault_class *class)
 {
 	struct supplemental_page_table *spt UNUSED = &thread_current()->spt;
 	struct page *page = NULL;
+
+	*class = FAULT_INVALID;
 	/* TODO: Validate the fault */
 	if (addr == NULL)
 		return false;
@@ -190,11 +895,432 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 			return false;
 		if (write == 1 && page->writable == 0)
 			return false;
-		return vm_do_claim_page(page);
+		*class = classify_fault(page);
+
+		/* Reading memory nobody wrote yet needs no frame of its own. */
+		if (!write && page_is_pristine(page))
+			return vm_map_zero(page);
+		if (page_is_pristine(page) && vm_map_huge(spt, page))
+			return true;
+
+		/* The uninit aux is gone once the page is loaded, so note
+		 * where it comes from first. */
+		struct file_meta_data *meta = page_file_meta(page);
+		struct inode *inode = meta != NULL ? file_get_inode(meta->file) : NULL;
+		off_t ofs = meta != NULL ? meta->ofs : 0;
+
+		if (!(page_is_shared_text(page) ? vm_map_text(page, true) : vm_do_claim_page(page)))
+			return false;
+		vm_fault_around(spt, page, inode, ofs);
+		return true;
+	}
+
+	if (write)
+	{
+		page = spt_find_page(spt, addr);
+		if (page != NULL)
+		{
+			return vm_handle_wp(page, class);
+		}
 	}
 	return false;
 }
 
+/* Return true on success */
+bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
+						 bool user UNUSED, bool write UNUSED, bool not_present UNUSED)
+{
+	enum fault_class class;
+	uint64_t start = rdtsc();
+	bool success = vm_handle_fault(addr, write, not_present, &class);
+
+	if (!success)
+		class = FAULT_INVALID;
+	fault_stat_record(class, rdtsc() - start);
+	if (class == FAULT_LAZY_FILE)
+		launch_record(&thread_current()->spt, addr);
+	return success;
+}
+
+/* Returns true if PAGE is an anonymous page that was never loaded and
+ * would start out all zeros: a plain anonymous page, or a BSS page of
+ * an ELF segment. */
+static bool
+page_is_pristine(struct page *page)
+{
+	if (VM_TYPE(page->operations->type) != VM_UNINIT || VM_TYPE(page->uninit.type) != VM_ANON)
+		return false;
+	if (page->uninit.init == NULL)
+		return true;
+	struct file_meta_data *meta = page_file_meta(page);
+	return meta != NULL && meta->page_read_bytes == 0;
+}
+
+/* Turns the uninit anonymous PAGE into an anonymous page that maps
+ * the shared FRAME read-only.  The caller has already taken PAGE's
+ * reference to FRAME; it is dropped again on failure. */
+static bool
+vm_map_shared(struct page *page, struct frame *frame)
+{
+	struct uninit_page *uninit = &page->uninit;
+	void *aux = uninit->aux;
+	bool success = uninit->page_initializer(page, uninit->type, frame->kva);
+
+	if (success)
+		free(aux);
+	lock_acquire(&frame_lock);
+	if (success)
+		success = pml4_set_page(page->owner->pml4, page->va, frame->kva, false);
+	if (success)
+		vm_frame_link(frame, page);
+	else
+		frame_put_shared(frame);
+	lock_release(&frame_lock);
+	return success;
+}
+
+/* Turns the pristine PAGE into an anonymous page that maps the zero
+ * frame read-only.  The first write fault gives it a frame. */
+static bool
+vm_map_zero(struct page *page)
+{
+	lock_acquire(&frame_lock);
+	zero_frame.share_cnt++;
+	zero_map_cnt++;
+	lock_release(&frame_lock);
+	return vm_map_shared(page, &zero_frame);
+}
+
+/* Backs the whole 2 MB region around PAGE with a 2 MB-aligned run of
+ * user frames mapped by one page directory entry, so a sweep over it
+ * takes one fault and few TLB entries.  Every page of the region
+ * must be pristine and writable, and nothing is evicted for the run.
+ * Each 4 kB page still gets a frame of its own in the frame table;
+ * the mmu splits the mapping as soon as one of them is unmapped or
+ * remapped, by eviction, copy-on-write or KSM.  Returns false, with
+ * nothing changed, if the region does not qualify. */
+static bool
+vm_map_huge(struct supplemental_page_table *spt, struct page *page)
+{
+	void *base = (void *)((uint64_t)page->va & ~(HPGSIZE - 1));
+	/* The leaf of the spt covers exactly this region. */
+	struct page **slots = spt_walk(spt, base, false);
+	size_t i;
+
+	if (slots == NULL)
+		return false;
+	for (i = 0; i < HPGCNT; i++)
+		if (slots[i] == NULL || !slots[i]->writable || !page_is_pristine(slots[i]))
+			return false;
+
+	uint8_t *kva = palloc_get_aligned(PAL_USER | PAL_ZERO, HPGCNT, HPGCNT);
+	struct frame **frames = palloc_get_page(0);
+	i = 0;
+	if (kva == NULL || frames == NULL)
+		goto fail;
+	for (; i < HPGCNT; i++)
+		if ((frames[i] = malloc(sizeof(struct frame))) == NULL)
+			goto fail;
+	if (!pml4_set_huge_page(page->owner->pml4, base, kva, true))
+		goto fail;
+
+	/* The run is already zeroed, which is all a pristine page's
+	 * initializer would do. */
+	for (size_t j = 0; j < HPGCNT; j++)
+	{
+		struct page *p = slots[j];
+		struct uninit_page *uninit = &p->uninit;
+		void *aux = uninit->aux;
+
+		if (!uninit->page_initializer(p, uninit->type, kva + j * PGSIZE))
+		{
+			/* The pages set up so far have no frame yet and read
+			 * zeros when they fault, as they would have anyway. */
+			for (j = 0; j < HPGCNT; j++)
+				pml4_clear_page(page->owner->pml4, (uint8_t *)base + j * PGSIZE);
+			goto fail;
+		}
+		free(aux);
+	}
+	for (i = 0; i < HPGCNT; i++)
+	{
+		struct page *p = slots[i];
+
+		frame_reset(frames[i]);
+		frames[i]->kva = kva + i * PGSIZE;
+		frames[i]->page = p;
+		vm_frame_link(frames[i], p);
+	}
+
+	lock_acquire(&frame_lock);
+	for (i = 0; i < HPGCNT; i++)
+		frame_table_add(frames[i]);
+	thp_map_cnt++;
+	lock_release(&frame_lock);
+	palloc_free_page(frames);
+	return true;
+
+fail:
+	if (frames != NULL)
+	{
+		for (size_t j = 0; j < i; j++)
+			free(frames[j]);
+		palloc_free_page(frames);
+	}
+	if (kva != NULL)
+		palloc_free_multiple(kva, HPGCNT);
+	thp_fallback_cnt++;
+	return false;
+}
+
+/* Returns true if PAGE is a never-loaded page of a read-only ELF
+ * segment, which can share its frame with other processes running
+ * the same executable. */
+static bool
+page_is_shared_text(struct page *page)
+{
+	if (page->writable || VM_TYPE(page->operations->type) != VM_UNINIT || VM_TYPE(page->uninit.type) != VM_ANON)
+		return false;
+	struct file_meta_data *meta = page_file_meta(page);
+	return meta != NULL && meta->page_read_bytes > 0;
+}
+
+/* Maps the shared text frame for PAGE, reading it from the executable
+ * if no process has it cached.  Evicts for that only if MAY_EVICT. */
+static bool
+vm_map_text(struct page *page, bool may_evict)
+{
+	struct file_meta_data *meta = page->uninit.aux;
+	struct inode *inode = file_get_inode(meta->file);
+	struct frame *frame, *fresh;
+
+	lock_acquire(&frame_lock);
+	frame = text_cache_lookup(inode, meta->ofs, meta->page_read_bytes);
+	lock_release(&frame_lock);
+	if (frame != NULL)
+		return vm_map_shared(page, frame);
+
+	fresh = frame_alloc(may_evict);
+	if (fresh == NULL)
+		return false;
+	if (file_read_at(meta->file, fresh->kva, meta->page_read_bytes, meta->ofs) != (off_t)meta->page_read_bytes)
+	{
+		palloc_free_page(fresh->kva);
+		free(fresh);
+		return false;
+	}
+	memset(fresh->kva + meta->page_read_bytes, 0, meta->page_zero_bytes);
+
+	/* Another process may have read the same page meanwhile. */
+	lock_acquire(&frame_lock);
+	frame = text_cache_lookup(inode, meta->ofs, meta->page_read_bytes);
+	if (frame == NULL && text_cache_insert(fresh, inode, meta->ofs, meta->page_read_bytes))
+	{
+		frame = fresh;
+		fresh = NULL;
+		frame_table_add(frame);
+	}
+	lock_release(&frame_lock);
+
+	if (fresh != NULL)
+	{
+		palloc_free_page(fresh->kva);
+		free(fresh);
+	}
+	return frame != NULL && vm_map_shared(page, frame);
+}
+
+/* Returns where PAGE is read from if it is backed by a file and not
+ * currently loaded: a VM_MARKER_1 page that has never been faulted in,
+ * or a file page that was evicted.  Otherwise returns NULL. */
+static struct file_meta_data *
+page_file_meta(struct page *page)
+{
+	if (page->frame != NULL)
+		return NULL;
+	if (VM_TYPE(page->operations->type) == VM_UNINIT)
+		return (page->uninit.type & VM_MARKER_1) ? page->uninit.aux : NULL;
+	if (VM_TYPE(page->operations->type) == VM_FILE)
+		return &page->file.meta;
+	return NULL;
+}
+
+/* Loads the unloaded PAGE ahead of any access to it, evicting for
+ * that only if MAY_EVICT. */
+static bool
+vm_load_ahead(struct page *page, bool may_evict)
+{
+	if (page_is_shared_text(page))
+		return vm_map_text(page, may_evict);
+
+	struct frame *frame = frame_alloc(may_evict);
+	return frame != NULL && vm_install_frame(page, frame);
+}
+
+/* Clears the accessed bits of the pages a sequential reader at VA
+ * left FAULT_AROUND_MAX pages behind, so the clock takes them before
+ * anything that may still be in use. */
+static void
+vm_age_behind(struct supplemental_page_table *spt, void *va)
+{
+	lock_acquire(&frame_lock);
+	for (size_t i = FAULT_AROUND_MAX + 1; i <= 2 * FAULT_AROUND_MAX; i++)
+	{
+		if ((uint64_t)va < i * PGSIZE)
+			break;
+		struct page *page = spt_find_page(spt, va - i * PGSIZE);
+		if (page != NULL && page->advice == VM_ADV_SEQUENTIAL && page->frame != NULL && page->frame->share_cnt == 0)
+		{
+			pml4_set_accessed(page->owner->pml4, page->va, false);
+			page->frame->clock_referenced = false;
+		}
+	}
+	lock_release(&frame_lock);
+}
+
+/* Maps the file pages that follow PAGE, which was just faulted in
+ * from INODE at OFS, so a sequential reader does not take one fault
+ * per page.  The window stays closed until two faults in a row hit
+ * the page right after the previous one, then doubles with every
+ * further sequential fault up to FAULT_AROUND_MAX.  A random access
+ * closes it again.  Neighbours are only mapped while free frames
+ * remain; fault-around never evicts.
+ *
+ * madvise() overrides the heuristic: MADV_RANDOM pages never read
+ * ahead, MADV_SEQUENTIAL pages always use the full window and age
+ * the pages behind them. */
+static void
+vm_fault_around(struct supplemental_page_table *spt, struct page *page,
+				struct inode *inode, off_t ofs)
+{
+	if (page->va == spt->ra_next)
+		spt->ra_streak++;
+	else
+		spt->ra_streak = 0;
+	spt->ra_next = page->va + PGSIZE;
+
+	if (page->advice == VM_ADV_SEQUENTIAL)
+		vm_age_behind(spt, page->va);
+	if (inode == NULL || page->advice == VM_ADV_RANDOM)
+		return;
+
+	size_t window;
+	if (page->advice == VM_ADV_SEQUENTIAL)
+		window = FAULT_AROUND_MAX;
+	else if (spt->ra_streak >= 2)
+	{
+		unsigned shift = spt->ra_streak - 1;
+		window = shift < 5 ? 1u << shift : FAULT_AROUND_MAX;
+	}
+	else
+		return;
+
+	for (size_t i = 1; i <= window; i++)
+	{
+		void *va = page->va + i * PGSIZE;
+		struct page *next = spt_find_page(spt, va);
+		if (next == NULL)
+			break;
+
+		/* Only pages that really read the same file, right after the
+		 * previous one.  Zero-fill pages gain nothing from this. */
+		struct file_meta_data *meta = page_file_meta(next);
+		if (meta == NULL || meta->page_read_bytes == 0 || meta->ofs != ofs + (off_t)(i * PGSIZE) || file_get_inode(meta->file) != inode)
+			break;
+
+		if (!vm_load_ahead(next, false))
+			break;
+
+		spt->ra_next = va + PGSIZE;
+		fault_around_cnt++;
+	}
+}
+
+/* Loads every page of the current process in [ADDR, ADDR + LENGTH)
+ * that is not in memory yet, so touching them later takes no fault.
+ * Pages that would only read zeros are left to the zero frame.
+ * Stops at the first page that cannot get a frame; frames are only
+ * taken from other pages if MAY_EVICT.  Returns the number of pages
+ * loaded. */
+size_t vm_prefetch(void *addr, size_t length, bool may_evict)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	size_t loaded = 0;
+
+	for (void *va = pg_round_down(addr); va < addr + length; va += PGSIZE)
+	{
+		struct page *page = spt_find_page(spt, va);
+		if (page == NULL || page->frame != NULL || page_is_pristine(page))
+			continue;
+		if (!vm_load_ahead(page, may_evict))
+			break;
+		prefetch_cnt++;
+		loaded++;
+	}
+	return loaded;
+}
+
+/* Throws away what PAGE holds in memory.  A mapped file page is
+ * written back and read again on the next access; a writable
+ * anonymous page starts over as zeros.  Read-only anonymous pages and
+ * the data pages of the executable cannot be rebuilt and are kept. */
+static void
+vm_drop_page(struct page *page)
+{
+	switch (VM_TYPE(page->operations->type))
+	{
+	case VM_FILE:
+		if (page->frame == NULL)
+			return;
+		file_backed_discard(page);
+		break;
+	case VM_ANON:
+		if (!page->writable || page->anon.from_file)
+			return;
+		anon_discard(page);
+		break;
+	default:
+		return;
+	}
+	dontneed_cnt++;
+}
+
+/* Applies ADVICE to the pages of the current process in [ADDR,
+ * ADDR + LENGTH).  Unmapped addresses in the range are skipped.
+ * Returns false if ADVICE is unknown. */
+bool vm_advise(void *addr, size_t length, enum vm_advice advice)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+
+	switch (advice)
+	{
+	case VM_ADV_NORMAL:
+	case VM_ADV_RANDOM:
+	case VM_ADV_SEQUENTIAL:
+		break;
+	case VM_ADV_WILLNEED:
+		/* Only free frames: a hint is not worth evicting for. */
+		vm_prefetch(addr, length, false);
+		return true;
+	case VM_ADV_DONTNEED:
+		break;
+	default:
+		return false;
+	}
+
+	for (void *va = pg_round_down(addr); va < addr + length; va += PGSIZE)
+	{
+		struct page *page = spt_find_page(spt, va);
+		if (page == NULL)
+			continue;
+		if (advice == VM_ADV_DONTNEED)
+			vm_drop_page(page);
+		else
+			page->advice = advice;
+	}
+	return true;
+}
+
 /* Free the page.
  * DO NOT MODIFY THIS FUNCTION. */
 void vm_dealloc_page(struct page *page)
@@ -217,47 +1343,194 @@ bool vm_claim_page(void *va UNUSED)
 static bool
 vm_do_claim_page(struct page *page)
 {
-	struct frame *frame = vm_get_frame();
+	return vm_install_frame(page, vm_get_frame());
+}
 
-	/* Set links */
+/* Loads PAGE into FRAME and maps it.  On failure FRAME is freed. */
+static bool
+vm_install_frame(struct page *page, struct frame *frame)
+{
+	/* Set links.  Nobody else sees FRAME before it joins the table. */
 	frame->page = page;
-	page->frame = frame;
+	vm_frame_link(frame, page);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
-	struct thread *current = thread_current();
-	pml4_set_page(current->pml4, page->va, frame->kva, page->writable);
+	uint64_t *pml4 = page->owner->pml4;
+	if (!pml4_set_page(pml4, page->va, frame->kva, page->writable)
+		|| !swap_in(page, frame->kva)) // uninit_initialize
+	{
+		vm_frame_unlink(frame, page);
+		palloc_free_page(frame->kva);
+		free(frame);
+		return false;
+	}
+
+	/* Only a fully loaded frame becomes an eviction candidate. */
+	lock_acquire(&frame_lock);
+	frame_table_add(frame);
+	lock_release(&frame_lock);
+	return true;
+}
 
-	return swap_in(page, frame->kva); // uninit_initialize
+/* Initialize new supplemental page table */
+void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED)
+{
+	spt->root = NULL;
+	spt->ra_next = NULL;
+	spt->ra_streak = 0;
+	memset(spt->fault_cnt, 0, sizeof spt->fault_cnt);
+	spt->launch = NULL;
+	spt->rss = 0;
+	spt->wss = 0;
+	spt->wss_cur = 0;
+	spt->wss_epoch = 0;
 }
 
-/* Returns a hash value for page p. */
-unsigned
-page_hash(const struct hash_elem *p_, void *aux UNUSED)
+/* Copy supplemental page table from src to dst */
+bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
+								  struct supplemental_page_table *src UNUSED)
 {
-	const struct page *p = hash_entry(p_, struct page, hash_elem);
-	return hash_bytes(&p->va, sizeof p->va);
+	/* 부모 페이지 내용을 옮겨 담을 커널 버퍼 */
+	void *bounce = palloc_get_page(0);
+	if (bounce == NULL)
+		return false;
+
+	bool success = spt_for_each(src, spt_copy_page, bounce);
+	palloc_free_page(bounce);
+	return success;
 }
 
-/* Returns true if page a precedes page b. */
-bool page_less(const struct hash_elem *a_,
-			   const struct hash_elem *b_, void *aux UNUSED)
+/* Duplicates the aux of the uninit page SRC for the current process. */
+static bool
+copy_uninit_aux(struct page *src, void **aux)
 {
-	const struct page *a = hash_entry(a_, struct page, hash_elem);
-	const struct page *b = hash_entry(b_, struct page, hash_elem);
+	struct uninit_page *uninit = &src->uninit;
+	size_t size = VM_TYPE(uninit->type) == VM_FILE ? sizeof(struct file_page)
+												   : sizeof(struct file_meta_data);
+
+	*aux = NULL;
+	if (uninit->aux == NULL)
+		return true;
+	if (!(uninit->type & VM_MARKER_1))
+		return false;
 
-	return a->va < b->va;
+	struct file_meta_data *meta = malloc(size);
+	if (meta == NULL)
+		return false;
+	memcpy(meta, uninit->aux, size);
+
+	/* ELF 페이지는 자식의 실행 파일을, mmap 페이지는 자기 핸들을 쓴다. */
+	if (VM_TYPE(uninit->type) == VM_FILE)
+		meta->file = file_reopen(meta->file);
+	else if (meta->file == src->owner->running)
+		meta->file = thread_current()->running;
+	if (meta->file == NULL)
+	{
+		free(meta);
+		return false;
+	}
+	*aux = meta;
+	return true;
 }
 
-/* Initialize new supplemental page table */
-void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED)
+/* Adds a copy of the parent's page SRC to the current process.
+ * Pages that were never touched stay lazy; the others are copied
+ * through BOUNCE, a kernel page. */
+static bool
+spt_copy_contents(struct page *src, void *bounce)
 {
-	hash_init(&spt->spt_hash, page_hash, page_less, NULL);
+	if (VM_TYPE(src->operations->type) == VM_UNINIT)
+	{
+		void *aux;
+		if (!copy_uninit_aux(src, &aux))
+			return false;
+		if (!vm_alloc_page_with_initializer(src->uninit.type, src->va, src->writable,
+											src->uninit.init, aux))
+		{
+			free(aux);
+			return false;
+		}
+		return true;
+	}
+
+	/* A mapped file page starts over lazily from the file. */
+	if (VM_TYPE(src->operations->type) == VM_FILE)
+		return file_backed_fork(src);
+
+	/* Still all zeros: the child starts out pristine as well. */
+	if (src->frame == &zero_frame)
+		return vm_alloc_page(VM_ANON, src->va, src->writable);
+
+	/* Shared frames (text, merged pages) are mapped read-only
+	 * everywhere, so the child can simply map them too.  Eviction may
+	 * take a text frame away first; then the page is copied below. */
+	lock_acquire(&frame_lock);
+	struct frame *shared = src->frame;
+	if (shared != NULL && shared->share_cnt > 0)
+		frame_get_shared(shared);
+	else
+		shared = NULL;
+	lock_release(&frame_lock);
+	if (shared != NULL)
+	{
+		bool from_file = src->anon.from_file;
+		if (!vm_alloc_page(VM_ANON, src->va, src->writable))
+		{
+			lock_acquire(&frame_lock);
+			frame_put_shared(shared);
+			lock_release(&frame_lock);
+			return false;
+		}
+		struct page *dst = spt_find_page(&thread_current()->spt, src->va);
+		if (!vm_map_shared(dst, shared))
+			return false;
+		dst->anon.from_file = from_file;
+		return true;
+	}
+
+	/* Snapshot the parent's contents.  Another thread may evict the
+	 * page again before the lock is taken, so retry until it stays. */
+	for (;;)
+	{
+		if (src->frame == NULL && !vm_do_claim_page(src))
+			return false;
+		lock_acquire(&frame_lock);
+		bool resident = src->frame != NULL;
+		if (resident)
+			memcpy(bounce, src->frame->kva, PGSIZE);
+		lock_release(&frame_lock);
+		if (resident)
+			break;
+	}
+
+	if (!vm_alloc_page(page_get_type(src), src->va, src->writable))
+		return false;
+	struct page *dst = spt_find_page(&thread_current()->spt, src->va);
+	for (;;)
+	{
+		if (dst->frame == NULL && !vm_do_claim_page(dst))
+			return false;
+		lock_acquire(&frame_lock);
+		bool resident = dst->frame != NULL;
+		if (resident)
+			memcpy(dst->frame->kva, bounce, PGSIZE);
+		lock_release(&frame_lock);
+		if (resident)
+		{
+			dst->anon.from_file = src->anon.from_file;
+			return true;
+		}
+	}
 }
 
-/* Copy supplemental page table from src to dst */
-bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
-								  struct supplemental_page_table *src UNUSED)
+/* Copies the parent's page SRC along with its madvise() hint. */
+static bool
+spt_copy_page(struct page *src, void *bounce)
 {
+	if (!spt_copy_contents(src, bounce))
+		return false;
+	spt_find_page(&thread_current()->spt, src->va)->advice = src->advice;
+	return true;
 }
 
 /* Free the resource hold by the supplemental page table */
@@ -265,4 +1538,9 @@ void supplemental_page_table_kill(struct supplemental_page_table *spt UNUSED)
 {
 	/* TODO: Destroy all the supplemental_page_table hold by thread and
 	 * TODO: writeback all the modified contents to the storage. */
+	launch_stop(spt);
+	/* Each page's destroy hook writes back and releases its frame. */
+	if (spt->root != NULL)
+		spt_node_destroy(spt->root, 0);
+	spt->root = NULL;
 }
\ No newline at end of file
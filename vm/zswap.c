@@ -0,0 +1,229 @@
+/* zswap.c: Compressed page cache in front of the swap disk.
+ *
+ * anon_swap_out() hands every evicted page to zswap_store() first.  If
+ * the page compresses well it is kept in a fixed region of kernel
+ * memory instead of costing SECTORS_PER_PAGE PIO writes.  Only when
+ * that region is full are the least recently stored pages decompressed
+ * and written to their swap slot.  A page faulted back in (or freed)
+ * while still cached never touches the disk at all. */
+
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <hash.h>
+#include <list.h>
+#include <lz.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "devices/disk.h"
+#include "vm/vm.h"
+
+/* Kernel pages reserved for compressed data. */
+#define ZSWAP_PAGES 128
+
+/* Allocation unit inside the region. */
+#define ZSWAP_CHUNK 64
+#define ZSWAP_CHUNKS (ZSWAP_PAGES * PGSIZE / ZSWAP_CHUNK)
+
+/* Pages that do not shrink below this go straight to disk. */
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+
+/* One compressed page. */
+struct zswap_entry
+{
+	struct hash_elem elem;	   /* Element in entries, keyed by slot. */
+	struct list_elem lru_elem; /* Element in lru, oldest first. */
+	size_t slot;			   /* Swap slot the page belongs to. */
+	size_t chunk;			   /* First chunk in the region. */
+	size_t length;			   /* Compressed size in bytes. */
+};
+
+static uint8_t *region;		 /* ZSWAP_PAGES of compressed data. */
+static struct bitmap *chunk_map; /* Used chunks of REGION. */
+static struct hash entries;
+static struct list lru;
+static struct lock zswap_lock;
+
+/* Scratch buffers, only touched with zswap_lock held. */
+static uint8_t *compress_buf;
+static uint8_t *bounce;
+static uint16_t work[1 << LZ_HASH_BITS];
+
+/* Statistics. */
+static long long store_cnt;		 /* Pages accepted into the cache. */
+static long long reject_cnt;	 /* Pages that did not compress. */
+static long long hit_cnt;		 /* Swap-ins served from the cache. */
+static long long miss_cnt;		 /* Swap-ins that had to read the disk. */
+static long long writeback_cnt;	 /* Pages pushed out to disk. */
+static long long invalidate_cnt; /* Cached pages freed unread. */
+static long long raw_bytes;		 /* Uncompressed bytes accepted. */
+static long long packed_bytes;	 /* Compressed bytes accepted. */
+
+static uint64_t
+entry_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+	const struct zswap_entry *z = hash_entry(e, struct zswap_entry, elem);
+	return hash_bytes(&z->slot, sizeof z->slot);
+}
+
+static bool
+entry_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+{
+	return hash_entry(a, struct zswap_entry, elem)->slot < hash_entry(b, struct zswap_entry, elem)->slot;
+}
+
+/* Sets up the region.  If memory is short the cache simply stays
+ * disabled and every page goes to disk as before. */
+void zswap_init(void)
+{
+	lock_init(&zswap_lock);
+	list_init(&lru);
+	hash_init(&entries, entry_hash, entry_less, NULL);
+
+	region = palloc_get_multiple(0, ZSWAP_PAGES);
+	compress_buf = palloc_get_page(0);
+	bounce = palloc_get_page(0);
+	chunk_map = bitmap_create(ZSWAP_CHUNKS);
+	if (region == NULL || compress_buf == NULL || bounce == NULL || chunk_map == NULL)
+	{
+		printf("zswap: out of kernel memory, compressed cache disabled\n");
+		region = NULL;
+	}
+}
+
+static struct zswap_entry *
+entry_find(size_t slot)
+{
+	struct zswap_entry key;
+	key.slot = slot;
+	struct hash_elem *e = hash_find(&entries, &key.elem);
+	return e != NULL ? hash_entry(e, struct zswap_entry, elem) : NULL;
+}
+
+/* Unlinks E and gives its chunks back to the region. */
+static void
+entry_free(struct zswap_entry *e)
+{
+	hash_delete(&entries, &e->elem);
+	list_remove(&e->lru_elem);
+	bitmap_set_multiple(chunk_map, e->chunk, DIV_ROUND_UP(e->length, ZSWAP_CHUNK), false);
+	free(e);
+}
+
+/* Decompresses E into KVA. */
+static void
+entry_read(struct zswap_entry *e, void *kva)
+{
+	if (!lz_decompress(region + e->chunk * ZSWAP_CHUNK, e->length, kva, PGSIZE))
+		PANIC("zswap: corrupt entry for slot %zu", e->slot);
+}
+
+/* Writes the least recently stored page to its swap slot. */
+static void
+writeback_oldest(void)
+{
+	struct zswap_entry *e = list_entry(list_front(&lru), struct zswap_entry, lru_elem);
+	entry_read(e, bounce);
+	swap_slot_write(e->slot, bounce);
+	entry_free(e);
+	writeback_cnt++;
+}
+
+/* Tries to keep the page at KVA, destined for SLOT, compressed in
+ * memory.  Returns false if the caller must write it to disk. */
+bool zswap_store(size_t slot, const void *kva)
+{
+	if (region == NULL)
+		return false;
+
+	lock_acquire(&zswap_lock);
+	size_t length = lz_compress(kva, PGSIZE, compress_buf, ZSWAP_MAX_SIZE, work);
+	if (length == 0)
+	{
+		reject_cnt++;
+		lock_release(&zswap_lock);
+		return false;
+	}
+
+	struct zswap_entry *e = malloc(sizeof *e);
+	if (e == NULL)
+	{
+		lock_release(&zswap_lock);
+		return false;
+	}
+
+	/* Make room by retiring the oldest pages to disk. */
+	size_t chunks = DIV_ROUND_UP(length, ZSWAP_CHUNK);
+	size_t chunk;
+	while ((chunk = bitmap_scan_and_flip(chunk_map, 0, chunks, false)) == BITMAP_ERROR)
+		writeback_oldest();
+
+	e->slot = slot;
+	e->chunk = chunk;
+	e->length = length;
+	memcpy(region + chunk * ZSWAP_CHUNK, compress_buf, length);
+	hash_insert(&entries, &e->elem);
+	list_push_back(&lru, &e->lru_elem);
+
+	store_cnt++;
+	raw_bytes += PGSIZE;
+	packed_bytes += length;
+	lock_release(&zswap_lock);
+	return true;
+}
+
+/* Fills KVA with the cached copy of SLOT and drops it from the
+ * cache.  Returns false if SLOT is not cached. */
+bool zswap_load(size_t slot, void *kva)
+{
+	if (region == NULL)
+		return false;
+
+	lock_acquire(&zswap_lock);
+	struct zswap_entry *e = entry_find(slot);
+	if (e != NULL)
+	{
+		entry_read(e, kva);
+		entry_free(e);
+		hit_cnt++;
+	}
+	else
+		miss_cnt++;
+	lock_release(&zswap_lock);
+	return e != NULL;
+}
+
+/* Forgets any cached copy of SLOT without writing it back. */
+void zswap_invalidate(size_t slot)
+{
+	if (region == NULL)
+		return;
+
+	lock_acquire(&zswap_lock);
+	struct zswap_entry *e = entry_find(slot);
+	if (e != NULL)
+	{
+		entry_free(e);
+		invalidate_cnt++;
+	}
+	lock_release(&zswap_lock);
+}
+
+/* Prints hit rate, compression ratio and disk writes avoided. */
+void zswap_print_stats(void)
+{
+	long long lookups = hit_cnt + miss_cnt;
+	long long saved = (hit_cnt + invalidate_cnt) * (PGSIZE / DISK_SECTOR_SIZE);
+
+	printf("Zswap: %lld stores, %lld rejected, %lld hits of %lld lookups (%lld%%)\n",
+		   store_cnt, reject_cnt, hit_cnt, lookups,
+		   lookups ? hit_cnt * 100 / lookups : 0);
+	printf("Zswap: %lld bytes compressed to %lld (%lld%%), "
+		   "%lld writebacks, %lld sector writes saved\n",
+		   raw_bytes, packed_bytes, raw_bytes ? packed_bytes * 100 / raw_bytes : 0,
+		   writeback_cnt, saved);
+}